@@ -82,6 +82,7 @@ namespace
 
       _T( HELP_e )		| "help"		| "?";
       _T( SHELL_e )		| "shell"		| "sh";
+      _T( BATCH_e )		| "batch";
       _T( SHELL_QUIT_e )	| "quit"		| "exit" | "\004";
       _T( MOO_e )		| "moo";
 
@@ -156,6 +157,7 @@ DEF_ZYPPER_COMMAND( SOURCE_DOWNLOAD );
 
 DEF_ZYPPER_COMMAND( HELP );
 DEF_ZYPPER_COMMAND( SHELL );
+DEF_ZYPPER_COMMAND( BATCH );
 DEF_ZYPPER_COMMAND( SHELL_QUIT );
 DEF_ZYPPER_COMMAND( NONE );
 DEF_ZYPPER_COMMAND( MOO );
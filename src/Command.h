@@ -72,6 +72,7 @@ struct ZypperCommand
 
   static const ZypperCommand HELP;
   static const ZypperCommand SHELL;
+  static const ZypperCommand BATCH;
   static const ZypperCommand SHELL_QUIT;
   static const ZypperCommand MOO;
 
@@ -145,6 +146,7 @@ struct ZypperCommand
 
     HELP_e,
     SHELL_e,
+    BATCH_e,
     SHELL_QUIT_e,
     MOO_e,
 
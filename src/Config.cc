@@ -7,6 +7,7 @@
 
 #include <iostream>
 #include <unordered_map>
+#include <vector>
 extern "C"
 {
   #include <libintl.h>
@@ -18,7 +19,8 @@ extern "C"
 #include <zypp/base/Exception.h>
 #include <zypp/ZConfig.h>
 
-#include "utils/Augeas.h"
+#include "utils/ConfigCache.h"
+#include "utils/Profiler.h"
 #include "Config.h"
 
 // redefine _ gettext macro defined by ZYpp
@@ -32,6 +34,11 @@ using namespace zypp;
 
 const ConfigOption ConfigOption::MAIN_SHOW_ALIAS(ConfigOption::MAIN_SHOW_ALIAS_e);
 const ConfigOption ConfigOption::MAIN_REPO_LIST_COLUMNS(ConfigOption::MAIN_REPO_LIST_COLUMNS_e);
+const ConfigOption ConfigOption::MAIN_REFRESH_CHECK_TIMEOUT(ConfigOption::MAIN_REFRESH_CHECK_TIMEOUT_e);
+const ConfigOption ConfigOption::MAIN_SERVICE_REFRESH_TIMEOUT(ConfigOption::MAIN_SERVICE_REFRESH_TIMEOUT_e);
+const ConfigOption ConfigOption::MAIN_POOL_SNAPSHOT(ConfigOption::MAIN_POOL_SNAPSHOT_e);
+const ConfigOption ConfigOption::MAIN_QUERY_CACHE(ConfigOption::MAIN_QUERY_CACHE_e);
+const ConfigOption ConfigOption::MAIN_USE_DAEMON(ConfigOption::MAIN_USE_DAEMON_e);
 const ConfigOption ConfigOption::SOLVER_INSTALL_RECOMMENDS(ConfigOption::SOLVER_INSTALL_RECOMMENDS_e);
 const ConfigOption ConfigOption::SOLVER_FORCE_RESOLUTION_COMMANDS(ConfigOption::SOLVER_FORCE_RESOLUTION_COMMANDS_e);
 const ConfigOption ConfigOption::COLOR_USE_COLORS(ConfigOption::COLOR_USE_COLORS_e);
@@ -58,6 +65,11 @@ namespace
     static const std::vector<OptionPair> _data = {
       { "main/showAlias",			ConfigOption::MAIN_SHOW_ALIAS_e			},
       { "main/repoListColumns",			ConfigOption::MAIN_REPO_LIST_COLUMNS_e		},
+      { "main/refreshCheckTimeout",		ConfigOption::MAIN_REFRESH_CHECK_TIMEOUT_e	},
+      { "main/serviceRefreshTimeout",		ConfigOption::MAIN_SERVICE_REFRESH_TIMEOUT_e	},
+      { "main/poolSnapshot",			ConfigOption::MAIN_POOL_SNAPSHOT_e		},
+      { "main/queryCache",			ConfigOption::MAIN_QUERY_CACHE_e		},
+      { "main/useDaemon",			ConfigOption::MAIN_USE_DAEMON_e			},
       { "solver/installRecommends",		ConfigOption::SOLVER_INSTALL_RECOMMENDS_e	},
       { "solver/forceResolutionCommands",	ConfigOption::SOLVER_FORCE_RESOLUTION_COMMANDS_e},
       { "color/useColors",			ConfigOption::COLOR_USE_COLORS_e		},
@@ -132,6 +144,11 @@ string ConfigOption::asString() const
 Config::Config()
   : show_alias(false)
   , repo_list_columns("anr")
+  , refresh_check_timeout(10)
+  , service_refresh_timeout(120)
+  , pool_snapshot(false)
+  , query_cache(false)
+  , use_daemon(false)
   , solver_installRecommends(!ZConfig::instance().solver_onlyRequires())
   , do_colors        (false)
   , color_useColors  ("never")
@@ -153,34 +170,69 @@ void Config::read(const string & file)
   try
   {
     debug::Measure m("ReadConfig");
+    ProfileScope profile("config read");
     string s;
 
-    Augeas augeas(file);
+    // the resolved values, from the cache if the config files didn't change
+    vector<string> options;
+    for ( const auto & p : optionPairs() )
+      options.push_back(p.first);
+    ConfigCache conf(file, options);
 
     m.elapsed();
 
     // ---------------[ main ]--------------------------------------------------
 
-    s = augeas.getOption(ConfigOption::MAIN_SHOW_ALIAS.asString());
+    s = conf.getOption(ConfigOption::MAIN_SHOW_ALIAS.asString());
     if (!s.empty())
     {
       show_alias = str::strToBool(s, false);
       ZConfig::instance().repoLabelIsAlias(show_alias);
     }
 
-    s = augeas.getOption(ConfigOption::MAIN_REPO_LIST_COLUMNS.asString());
+    s = conf.getOption(ConfigOption::MAIN_REPO_LIST_COLUMNS.asString());
     if (!s.empty()) // TODO add some validation
       repo_list_columns = s;
 
+    s = conf.getOption(ConfigOption::MAIN_REFRESH_CHECK_TIMEOUT.asString());
+    if (!s.empty())
+    {
+      if (s.find_first_not_of("0123456789") == string::npos)
+        refresh_check_timeout = str::strtonum<unsigned>(s);
+      else
+        ERR << "invalid main/refreshCheckTimeout value: " << s << endl;
+    }
+
+    s = conf.getOption(ConfigOption::MAIN_SERVICE_REFRESH_TIMEOUT.asString());
+    if (!s.empty())
+    {
+      if (s.find_first_not_of("0123456789") == string::npos)
+        service_refresh_timeout = str::strtonum<unsigned>(s);
+      else
+        ERR << "invalid main/serviceRefreshTimeout value: " << s << endl;
+    }
+
+    s = conf.getOption(ConfigOption::MAIN_POOL_SNAPSHOT.asString());
+    if (!s.empty())
+      pool_snapshot = str::strToBool(s, false);
+
+    s = conf.getOption(ConfigOption::MAIN_QUERY_CACHE.asString());
+    if (!s.empty())
+      query_cache = str::strToBool(s, false);
+
+    s = conf.getOption(ConfigOption::MAIN_USE_DAEMON.asString());
+    if (!s.empty())
+      use_daemon = str::strToBool(s, false);
+
     // ---------------[ solver ]------------------------------------------------
 
-    s = augeas.getOption(ConfigOption::SOLVER_INSTALL_RECOMMENDS.asString());
+    s = conf.getOption(ConfigOption::SOLVER_INSTALL_RECOMMENDS.asString());
     if (s.empty())
       solver_installRecommends = !ZConfig::instance().solver_onlyRequires();
     else
       solver_installRecommends = str::strToBool(s, true);
 
-    s = augeas.getOption(ConfigOption::SOLVER_FORCE_RESOLUTION_COMMANDS.asString());
+    s = conf.getOption(ConfigOption::SOLVER_FORCE_RESOLUTION_COMMANDS.asString());
     if (s.empty())
       solver_forceResolutionCommands.insert(ZypperCommand::REMOVE);
     else
@@ -194,14 +246,14 @@ void Config::read(const string & file)
 
     // ---------------[ colors ]------------------------------------------------
 
-    color_useColors = augeas.getOption(ConfigOption::COLOR_USE_COLORS.asString());
+    color_useColors = conf.getOption(ConfigOption::COLOR_USE_COLORS.asString());
     do_colors =
       (color_useColors == "autodetect" && has_colors())
       || color_useColors == "always";
 
     ////// color/background //////
 
-    s = augeas.getOption(ConfigOption::COLOR_BACKGROUND.asString());
+    s = conf.getOption(ConfigOption::COLOR_BACKGROUND.asString());
     if (s == "light")
       color_background = true;
     else if (!s.empty() && s != "dark")
@@ -211,7 +263,7 @@ void Config::read(const string & file)
 
     ////// color/colorResult //////
 
-    c = Color(augeas.getOption(ConfigOption::COLOR_RESULT.asString()));
+    c = Color(conf.getOption(ConfigOption::COLOR_RESULT.asString()));
     if (c.value().empty())
     {
       // set a default for light background
@@ -223,7 +275,7 @@ void Config::read(const string & file)
 
     ////// color/colorMsgStatus //////
 
-    c = Color(augeas.getOption(ConfigOption::COLOR_MSG_STATUS.asString()));
+    c = Color(conf.getOption(ConfigOption::COLOR_MSG_STATUS.asString()));
     if (c.value().empty())
     {
       // set a default for light background
@@ -235,13 +287,13 @@ void Config::read(const string & file)
 
     ////// color/colorMsgError //////
 
-    c = Color(augeas.getOption(ConfigOption::COLOR_MSG_ERROR.asString()));
+    c = Color(conf.getOption(ConfigOption::COLOR_MSG_ERROR.asString()));
     if (!c.value().empty())
       color_msgError = c;
 
     ////// color/colorMsgWarning //////
 
-    c = Color(augeas.getOption(ConfigOption::COLOR_MSG_WARNING.asString()));
+    c = Color(conf.getOption(ConfigOption::COLOR_MSG_WARNING.asString()));
     if (c.value().empty())
     {
       // set a default for light background
@@ -253,25 +305,25 @@ void Config::read(const string & file)
 
     ////// color/colorPositive //////
 
-    c = Color(augeas.getOption(ConfigOption::COLOR_POSITIVE.asString()));
+    c = Color(conf.getOption(ConfigOption::COLOR_POSITIVE.asString()));
     if (!c.value().empty())
       color_positive = c;
 
     ////// color/colorNegative //////
 
-    c = Color(augeas.getOption(ConfigOption::COLOR_NEGATIVE.asString()));
+    c = Color(conf.getOption(ConfigOption::COLOR_NEGATIVE.asString()));
     if (!c.value().empty())
       color_negative = c;
 
     ////// color/highlight //////
 
-    c = Color(augeas.getOption(ConfigOption::COLOR_HIGHLIGHT.asString()));
+    c = Color(conf.getOption(ConfigOption::COLOR_HIGHLIGHT.asString()));
     if (!c.value().empty())
       color_highlight = c;
 
     ////// color/colorPromptOption //////
 
-    c = Color(augeas.getOption(ConfigOption::COLOR_PROMPT_OPTION.asString()));
+    c = Color(conf.getOption(ConfigOption::COLOR_PROMPT_OPTION.asString()));
     if (c.value().empty())
     {
       // set a default for light background
@@ -284,7 +336,7 @@ void Config::read(const string & file)
 
     // ---------------[ obs ]---------------------------------------------------
 
-    s = augeas.getOption(ConfigOption::OBS_BASE_URL.asString());
+    s = conf.getOption(ConfigOption::OBS_BASE_URL.asString());
     if (!s.empty())
     {
       try { obs_baseUrl = Url(s); }
@@ -294,7 +346,7 @@ void Config::read(const string & file)
       }
     }
 
-    s = augeas.getOption(ConfigOption::OBS_PLATFORM.asString());
+    s = conf.getOption(ConfigOption::OBS_PLATFORM.asString());
     if (!s.empty())
       obs_platform = s;
 
@@ -20,6 +20,11 @@ class ConfigOption
 public:
   static const ConfigOption MAIN_SHOW_ALIAS;
   static const ConfigOption MAIN_REPO_LIST_COLUMNS;
+  static const ConfigOption MAIN_REFRESH_CHECK_TIMEOUT;
+  static const ConfigOption MAIN_SERVICE_REFRESH_TIMEOUT;
+  static const ConfigOption MAIN_POOL_SNAPSHOT;
+  static const ConfigOption MAIN_QUERY_CACHE;
+  static const ConfigOption MAIN_USE_DAEMON;
 
   static const ConfigOption SOLVER_INSTALL_RECOMMENDS;
   static const ConfigOption SOLVER_FORCE_RESOLUTION_COMMANDS;
@@ -43,6 +48,11 @@ public:
   {
     MAIN_SHOW_ALIAS_e,
     MAIN_REPO_LIST_COLUMNS_e,
+    MAIN_REFRESH_CHECK_TIMEOUT_e,
+    MAIN_SERVICE_REFRESH_TIMEOUT_e,
+    MAIN_POOL_SNAPSHOT_e,
+    MAIN_QUERY_CACHE_e,
+    MAIN_USE_DAEMON_e,
 
     SOLVER_INSTALL_RECOMMENDS_e,
     SOLVER_FORCE_RESOLUTION_COMMANDS_e,
@@ -95,6 +105,30 @@ struct Config
   /** Which columns to show in repo list by default (string of short options).*/
   std::string repo_list_columns;
 
+  /**
+   * Time limit in seconds for the concurrent up-to-date checks of autorefresh
+   * repos (0 = check the repos one by one without a limit).
+   */
+  unsigned refresh_check_timeout;
+
+  /** Time limit in seconds for refreshing one service (0 = no limit). */
+  unsigned service_refresh_timeout;
+
+  /**
+   * Whether to reuse the status computed by the solver for the query
+   * commands while the pool does not change (see PoolSnapshot.h).
+   */
+  bool pool_snapshot;
+
+  /**
+   * Whether to reuse the output of the query commands while the repos and
+   * the installed packages do not change (see QueryCache.h).
+   */
+  bool query_cache;
+
+  /** Whether to let zypperd run the query commands if it is running (off by default). */
+  bool use_daemon;
+
   bool solver_installRecommends;
   std::set<ZypperCommand> solver_forceResolutionCommands;
 
@@ -0,0 +1,639 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <clocale>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <grp.h>
+#include <pwd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include <zypp/ZYppFactory.h>
+#include <zypp/ZConfig.h>
+#include <zypp/PathInfo.h>
+#include <zypp/base/Easy.h>
+#include <zypp/base/Logger.h>
+#include <zypp/base/String.h>
+
+#include "main.h"
+#include "Zypper.h"
+#include "repos.h"
+#include "utils/misc.h"
+
+#include "Daemon.h"
+
+using namespace std;
+using namespace zypp;
+
+extern ZYpp::Ptr God;
+
+/** Max number of requests served at a time. */
+#define ZYPPERD_MAX_CLIENTS 16
+/** How often to check whether the pool needs to be reloaded (ms). */
+#define ZYPPERD_CHECK_INTERVAL 1000
+/** How long to wait before loading the pool again after a failure (s). */
+#define ZYPPERD_RETRY_DELAY 60
+/** Max size of a request. */
+#define ZYPPERD_MAX_REQUEST 65536
+
+/**
+ * Environment variables passed from the client to the command. HOME and
+ * XDG_CACHE_HOME locate the user's ~/.zypper.conf and cache directory.
+ */
+static const char * forwarded_env[] =
+{
+  "LANG", "LC_ALL", "LC_CTYPE", "LC_MESSAGES", "COLUMNS", "TERM",
+  "HOME", "XDG_CACHE_HOME", NULL
+};
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handleStopSignal(int)
+{ stop_requested = 1; }
+
+// ---------------------------------------------------------------------------
+
+static bool daemon_command(const ZypperCommand & command)
+{
+  switch (command.toEnum())
+  {
+  case ZypperCommand::SEARCH_e:
+  case ZypperCommand::RUG_PATCH_SEARCH_e:
+  case ZypperCommand::INFO_e:
+  case ZypperCommand::RUG_PATCH_INFO_e:
+  case ZypperCommand::RUG_PATTERN_INFO_e:
+  case ZypperCommand::RUG_PRODUCT_INFO_e:
+  case ZypperCommand::PATCHES_e:
+  case ZypperCommand::PATTERNS_e:
+  case ZypperCommand::PACKAGES_e:
+  case ZypperCommand::PRODUCTS_e:
+  case ZypperCommand::WHAT_PROVIDES_e:
+  case ZypperCommand::LIST_UPDATES_e:
+  case ZypperCommand::LIST_PATCHES_e:
+  case ZypperCommand::PATCH_CHECK_e:
+    return true;
+  default: ;
+  }
+  return false;
+}
+
+bool daemon_can_serve(Zypper & zypper)
+{
+  if (!daemon_command(zypper.command()))
+    return false;
+
+  // the resident pool is loaded with the default options
+  const GlobalOptions & gopts(zypper.globalOpts());
+  if (gopts.changedRoot
+      || gopts.disable_system_sources
+      || gopts.disable_system_resolvables
+      || gopts.no_cd
+      || gopts.no_remote
+      || !zypper.runtimeData().additional_repos.empty())
+    return false;
+
+  RepoManagerOptions defaults;
+  if (gopts.rm_options.knownReposPath != defaults.knownReposPath
+      || gopts.rm_options.repoRawCachePath != defaults.repoRawCachePath
+      || gopts.rm_options.repoSolvCachePath != defaults.repoSolvCachePath)
+    return false;
+
+  // and from all the repos
+  const parsed_opts & copts(zypper.cOpts());
+  if (copts.count("repo") || copts.count("catalog"))
+    return false;
+  switch (zypper.command().toEnum())
+  {
+  case ZypperCommand::PATCHES_e:
+  case ZypperCommand::PATTERNS_e:
+  case ZypperCommand::PACKAGES_e:
+  case ZypperCommand::PRODUCTS_e:
+    // the arguments are repos
+    return zypper.arguments().empty();
+  default: ;
+  }
+
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+
+static void fillSocketAddress(struct sockaddr_un & addr)
+{
+  ::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  ::strncpy(addr.sun_path, ZYPPERD_SOCKET, sizeof(addr.sun_path) - 1);
+}
+
+/** Send \a request along with our stdout and stderr. */
+static bool sendRequest(int sock, const string & request)
+{
+  int fds[2] = { STDOUT_FILENO, STDERR_FILENO };
+  char control[CMSG_SPACE(sizeof(fds))];
+  ::memset(control, 0, sizeof(control));
+
+  struct iovec iov;
+  iov.iov_base = const_cast<char *>(request.data());
+  iov.iov_len = request.size();
+
+  struct msghdr msg;
+  ::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  struct cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  ::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  ssize_t n = ::sendmsg(sock, &msg, 0);
+  if (n <= 0)
+    return false;
+
+  // the rest, without the descriptors
+  for (size_t sent = n; sent < request.size(); sent += n)
+  {
+    n = ::write(sock, request.data() + sent, request.size() - sent);
+    if (n < 0 && errno == EINTR)
+      n = 0;
+    else if (n <= 0)
+      return false;
+  }
+  return true;
+}
+
+/** Split \a data into \a args and \a env. \return false if incomplete */
+static bool parseRequest(const string & data,
+                         vector<string> & args, vector<string> & env)
+{
+  vector<string> strings;
+  for (string::size_type pos = 0, end; (end = data.find('\0', pos)) != string::npos; pos = end + 1)
+    strings.push_back(data.substr(pos, end - pos));
+
+  unsigned argc = 0;
+  if (strings.empty() || !(argc = str::strtonum<unsigned>(strings[0])))
+    return false;
+  if (strings.size() < argc + 2)
+    return false;
+  unsigned envc = str::strtonum<unsigned>(strings[argc + 1]);
+  if (strings.size() < argc + envc + 2)
+    return false;
+
+  args.assign(strings.begin() + 1, strings.begin() + 1 + argc);
+  env.assign(strings.begin() + argc + 2, strings.begin() + argc + 2 + envc);
+  return true;
+}
+
+/** Receive a request with the client's stdout and stderr in \a fds. */
+static bool receiveRequest(int sock, int fds[2],
+                           vector<string> & args, vector<string> & env)
+{
+  string data;
+  char buf[4096];
+  char control[CMSG_SPACE(2 * sizeof(int))];
+
+  while (!parseRequest(data, args, env))
+  {
+    if (data.size() > ZYPPERD_MAX_REQUEST)
+      return false;
+
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = sizeof(buf);
+
+    struct msghdr msg;
+    ::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n = ::recvmsg(sock, &msg, 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data.append(buf, n);
+
+    for (struct cmsghdr * cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+          && cmsg->cmsg_len == CMSG_LEN(2 * sizeof(int)))
+        ::memcpy(fds, CMSG_DATA(cmsg), 2 * sizeof(int));
+  }
+
+  return fds[0] >= 0 && fds[1] >= 0;
+}
+
+// ---------------------------------------------------------------------------
+
+bool daemon_forward(Zypper & zypper)
+{
+  if (!zypper.config().use_daemon || zypper.runningHelp() || !daemon_can_serve(zypper))
+    return false;
+  // zypperd does not refresh the repos, root's commands do it themselves
+  if (::geteuid() == 0 && !zypper.globalOpts().no_refresh && !refresh_daemon_running())
+  {
+    DBG << "autorefresh needed, not using zypperd" << endl;
+    return false;
+  }
+
+  int sock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0)
+    return false;
+
+  struct sockaddr_un addr;
+  fillSocketAddress(addr);
+  if (::connect(sock, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+  {
+    DBG << "zypperd not available: " << ::strerror(errno) << endl;
+    ::close(sock);
+    return false;
+  }
+
+  string request(str::numstring(zypper.argc()));
+  request += '\0';
+  for (int i = 0; i < zypper.argc(); ++i)
+  {
+    request += zypper.argv()[i];
+    request += '\0';
+  }
+  vector<string> env;
+  for (const char ** var = forwarded_env; *var; ++var)
+    if (const char * value = ::getenv(*var))
+      env.push_back(string(*var) + "=" + value);
+  request += str::numstring(env.size());
+  request += '\0';
+  for_(it, env.begin(), env.end())
+  {
+    request += *it;
+    request += '\0';
+  }
+
+  cout << flush;
+  cerr << flush;
+  if (!sendRequest(sock, request))
+  {
+    WAR << "could not send the request to zypperd: " << ::strerror(errno) << endl;
+    ::close(sock);
+    return false;
+  }
+
+  // on Ctrl+C just leave, zypperd stops the command once we are gone
+  void (*old_handler)(int) = ::signal(SIGINT, SIG_DFL);
+
+  string reply;
+  char buf[64];
+  ssize_t n;
+  while ((n = ::read(sock, buf, sizeof(buf))) != 0)
+  {
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    reply.append(buf, n);
+  }
+  ::close(sock);
+  ::signal(SIGINT, old_handler);
+
+  reply = str::trim(reply);
+  if (reply.empty() || reply == "refused")
+  {
+    MIL << "zypperd did not run the command (" << reply << "), running it here" << endl;
+    return false;
+  }
+
+  MIL << "command served by zypperd, exit code " << reply << endl;
+  zypper.setExitCode(str::strtonum<int>(reply));
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+
+/** Modification times of everything the loaded pool comes from. */
+static string poolStamp(Zypper & zypper)
+{
+  const RepoManagerOptions & opts(zypper.globalOpts().rm_options);
+  ostringstream str;
+  str << rpmdb_stamp("/")
+      << " " << PathInfo(opts.knownReposPath).mtime()
+      << " " << PathInfo(opts.repoSolvCachePath).mtime()
+      << " " << PathInfo(ZConfig::instance().locksFile()).mtime();
+  for_(it, zypper.runtimeData().repos.begin(), zypper.runtimeData().repos.end())
+    str << " " << PathInfo(it->filepath()).mtime()
+        << " " << PathInfo(opts.repoSolvCachePath / it->escaped_alias() / "solv").mtime();
+  return str.str();
+}
+
+/**
+ * Take the credentials of the client: its uid and gid, and the
+ * supplementary groups of its user (none if it has no passwd entry).
+ */
+static bool switchUser(const struct ucred & cred)
+{
+  struct passwd * pw = ::getpwuid(cred.uid);
+  int ret = pw ? ::initgroups(pw->pw_name, cred.gid) : ::setgroups(0, NULL);
+  return ret == 0 && ::setgid(cred.gid) == 0 && ::setuid(cred.uid) == 0;
+}
+
+/** Handle one connection, in a child of the pool server. */
+static void serveClient(Zypper & zypper, int listenfd, int sock)
+{
+  ::close(listenfd);
+
+  struct timeval timeout = { 5, 0 };
+  ::setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  int fds[2] = { -1, -1 };
+  vector<string> args, env;
+  if (!receiveRequest(sock, fds, args, env))
+  {
+    WAR << "invalid request" << endl;
+    ::_exit(1);
+  }
+
+  struct ucred cred;
+  socklen_t len = sizeof(cred);
+  if (::getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0)
+  {
+    ERR << "cannot get the client's credentials: " << ::strerror(errno) << endl;
+    ::_exit(1);
+  }
+  MIL << "request from pid " << cred.pid << ", uid " << cred.uid << ": " << str::join(args, " ") << endl;
+
+  pid_t pid = ::fork();
+  if (pid == 0)
+  {
+    // the command: the client's output and credentials, no input
+    ::close(sock);
+    ::dup2(fds[0], STDOUT_FILENO);
+    ::dup2(fds[1], STDERR_FILENO);
+    ::close(fds[0]);
+    ::close(fds[1]);
+    int nullfd = ::open("/dev/null", O_RDONLY);
+    if (nullfd >= 0)
+    {
+      ::dup2(nullfd, STDIN_FILENO);
+      ::close(nullfd);
+    }
+    ::signal(SIGTERM, SIG_DFL);
+    ::signal(SIGINT, SIG_DFL);
+    ::signal(SIGPIPE, SIG_DFL);
+
+    if (::getuid() != cred.uid && !switchUser(cred))
+    {
+      cerr << "zypperd: " << ::strerror(errno) << endl;
+      ::_exit(ZYPPER_EXIT_ERR_BUG);
+    }
+
+    // only the client's values, not ours
+    for (const char ** var = forwarded_env; *var; ++var)
+      ::unsetenv(*var);
+    for_(it, env.begin(), env.end())
+    {
+      string::size_type eq = it->find('=');
+      if (eq != string::npos)
+        ::setenv(it->substr(0, eq).c_str(), it->substr(eq + 1).c_str(), 1);
+    }
+    ::setlocale(LC_ALL, "");
+
+    vector<char *> argv;
+    for_(it, args.begin(), args.end())
+      argv.push_back(const_cast<char *>(it->c_str()));
+    argv.push_back(NULL);
+
+    int ret = zypper.daemonCommand(args.size(), &argv[0]);
+    cout << flush;
+    cerr << flush;
+    ::fflush(NULL);
+    ::_exit(ret & 0xff);
+  }
+  ::close(fds[0]);
+  ::close(fds[1]);
+  if (pid < 0)
+  {
+    ERR << "fork() failed: " << ::strerror(errno) << endl;
+    ::_exit(1);
+  }
+
+  // wait for the command, stop it if the client goes away
+  int status = 0;
+  pid_t ret;
+  while ((ret = ::waitpid(pid, &status, WNOHANG)) == 0)
+  {
+    struct pollfd pfd = { sock, POLLIN, 0 };
+    if (::poll(&pfd, 1, 100) > 0)
+    {
+      MIL << "client " << cred.pid << " went away, stopping its command" << endl;
+      ::kill(pid, SIGKILL);
+      ::waitpid(pid, &status, 0);
+      ::_exit(0);
+    }
+  }
+
+  string reply;
+  if (ret < 0 || !WIFEXITED(status))
+    reply = str::numstring(ZYPPER_EXIT_ERR_BUG);
+  else if (WEXITSTATUS(status) == ZYPPERD_EXIT_REFUSED)
+    reply = "refused";
+  else
+    reply = str::numstring(WEXITSTATUS(status));
+  reply += "\n";
+  if (::write(sock, reply.data(), reply.size()) < 0)
+    WAR << "could not send the reply: " << ::strerror(errno) << endl;
+  ::_exit(0);
+}
+
+/**
+ * Load the pool and serve the requests, until the pool needs to be reloaded
+ * or we are asked to stop. Runs in a child of the zypperd main process.
+ *
+ * \return 0 if the pool needs to be reloaded or on stop request,
+ *         non-zero if it could not be loaded
+ */
+static int servePool(Zypper & zypper, int listenfd)
+{
+  // don't lock out everyone else for as long as the daemon runs
+  zypp_readonly_hack::IWantIt();
+  God = zypp::getZYpp();
+
+  GlobalOptions & gopts(zypper.globalOptsNoConst());
+  // repos are refreshed by zypper or zypp-refresh, not behind their back
+  gopts.no_refresh = true;
+  gopts.non_interactive = true;
+
+  if (zypper.defaultLoadSystem() != ZYPPER_EXIT_OK)
+  {
+    ERR << "could not load the pool" << endl;
+    return 1;
+  }
+  // (the repos are known only after loading)
+  string stamp(poolStamp(zypper));
+  MIL << "pool loaded, serving requests" << endl;
+
+  unsigned clients = 0;
+  while (!stop_requested)
+  {
+    while (clients && ::waitpid(-1, NULL, WNOHANG) > 0)
+      --clients;
+    if (clients >= ZYPPERD_MAX_CLIENTS)
+    {
+      if (::waitpid(-1, NULL, 0) > 0)
+        --clients;
+      continue;
+    }
+
+    struct pollfd pfd = { listenfd, POLLIN, 0 };
+    int ret = ::poll(&pfd, 1, ZYPPERD_CHECK_INTERVAL);
+    if (ret < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      ERR << "poll() failed: " << ::strerror(errno) << endl;
+      return 1;
+    }
+
+    // leave any pending connection to the reloaded pool
+    if (poolStamp(zypper) != stamp)
+    {
+      MIL << "rpm database or repos changed, reloading the pool" << endl;
+      return 0;
+    }
+    if (ret == 0)
+      continue;
+
+    int sock = ::accept(listenfd, NULL, NULL);
+    if (sock < 0)
+      continue;
+
+    cout << flush;
+    ::fflush(NULL);
+    pid_t pid = ::fork();
+    if (pid == 0)
+      serveClient(zypper, listenfd, sock);
+    else if (pid > 0)
+      ++clients;
+    else
+      ERR << "fork() failed: " << ::strerror(errno) << endl;
+    ::close(sock);
+  }
+
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+
+int daemon_run(Zypper & zypper, bool foreground)
+{
+  int listenfd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenfd < 0)
+  {
+    zypper.out().error(string("socket(): ") + ::strerror(errno));
+    return ZYPPER_EXIT_ERR_BUG;
+  }
+
+  struct sockaddr_un addr;
+  fillSocketAddress(addr);
+  // not accessible by anyone until the owner and mode are set
+  ::unlink(ZYPPERD_SOCKET);
+  mode_t old_umask = ::umask(0177);
+  int ret = ::bind(listenfd, (struct sockaddr *) &addr, sizeof(addr));
+  ::umask(old_umask);
+
+  struct group * group = ::getgrnam(ZYPPERD_GROUP);
+  if (!group)
+    MIL << "no " << ZYPPERD_GROUP << " group, the socket is for root only" << endl;
+  if (ret == 0 && group)
+    ret = ::chown(ZYPPERD_SOCKET, 0, group->gr_gid);
+  if (ret == 0 && group)
+    ret = ::chmod(ZYPPERD_SOCKET, 0660);
+  if (ret != 0 || ::listen(listenfd, SOMAXCONN) != 0)
+  {
+    zypper.out().error(str::form("Cannot listen on %s: %s", ZYPPERD_SOCKET, ::strerror(errno)));
+    ::close(listenfd);
+    return ZYPPER_EXIT_ERR_PRIVILEGES;
+  }
+
+  if (!foreground && ::daemon(0, 0) != 0)
+  {
+    zypper.out().error(string("daemon(): ") + ::strerror(errno));
+    ::unlink(ZYPPERD_SOCKET);
+    return ZYPPER_EXIT_ERR_BUG;
+  }
+
+  struct sigaction sa;
+  ::memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = handleStopSignal;
+  ::sigaction(SIGTERM, &sa, NULL);
+  ::sigaction(SIGINT, &sa, NULL);
+  ::signal(SIGPIPE, SIG_IGN);
+
+  MIL << "zypperd listening on " << ZYPPERD_SOCKET << endl;
+
+  while (!stop_requested)
+  {
+    cout << flush;
+    ::fflush(NULL);
+    pid_t pid = ::fork();
+    if (pid < 0)
+    {
+      ERR << "fork() failed: " << ::strerror(errno) << endl;
+      break;
+    }
+    if (pid == 0)
+    {
+      int ret = 1;
+      try
+      {
+        ret = servePool(zypper, listenfd);
+      }
+      catch (const Exception & e)
+      {
+        ZYPP_CAUGHT(e);
+      }
+      ::_exit(ret);
+    }
+
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0)
+    {
+      if (errno != EINTR)
+        break;
+      if (stop_requested)
+        ::kill(pid, SIGTERM);
+    }
+    if (stop_requested)
+      break;
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+      WAR << "pool server failed, retrying in " << ZYPPERD_RETRY_DELAY << "s" << endl;
+      for (unsigned i = 0; i < ZYPPERD_RETRY_DELAY && !stop_requested; ++i)
+        ::sleep(1);
+    }
+  }
+
+  MIL << "zypperd stopping" << endl;
+  ::close(listenfd);
+  ::unlink(ZYPPERD_SOCKET);
+  return ZYPPER_EXIT_OK;
+}
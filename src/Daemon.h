@@ -0,0 +1,62 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+/**
+ * zypperd - resident zypper serving read-only commands.
+ *
+ * The daemon keeps the loaded pool in memory and runs query commands
+ * (search, info, packages, list-updates, ...) forwarded by the zypper
+ * client over a Unix socket. Each command runs in a forked child with the
+ * client's credentials, writing directly to the client's stdout and stderr
+ * (passed along with the request). The pool is reloaded as soon as the rpm
+ * database, the repos or their caches change.
+ *
+ * Request: the client's stdout and stderr descriptors (SCM_RIGHTS) and
+ * NUL terminated strings: the number of arguments, the arguments, the number
+ * of environment variables and the variables (NAME=value).
+ *
+ * Reply: one line with the exit code of the command, or 'refused' if the
+ * command can not be answered from the resident pool (the client then runs
+ * it on its own).
+ */
+#ifndef ZYPPER_DAEMON_H_
+#define ZYPPER_DAEMON_H_
+
+class Zypper;
+
+#define ZYPPERD_SOCKET "/var/run/zypperd.sock"
+/** Group allowed to connect to \ref ZYPPERD_SOCKET besides root. */
+#define ZYPPERD_GROUP "zypperd"
+
+/** Exit status of a daemon child which refused to run the command. */
+#define ZYPPERD_EXIT_REFUSED 254
+
+/**
+ * Whether the current command (including the global and command options)
+ * can be answered from the pool resident in zypperd.
+ */
+bool daemon_can_serve(Zypper & zypper);
+
+/**
+ * Let zypperd run the current command, if enabled in zypper.conf and the
+ * daemon is running. The exit code of the command is set in \a zypper.
+ *
+ * \return false if the command needs to be run locally
+ */
+bool daemon_forward(Zypper & zypper);
+
+/**
+ * The zypperd main loop: listen on \ref ZYPPERD_SOCKET and serve the
+ * requests until SIGTERM. The socket is accessible by root and the members
+ * of \ref ZYPPERD_GROUP (only root if there is no such group).
+ *
+ * \param foreground don't detach from the terminal
+ * \return exit code of zypperd
+ */
+int daemon_run(Zypper & zypper, bool foreground);
+
+#endif /* ZYPPER_DAEMON_H_ */
@@ -0,0 +1,153 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+#include <unistd.h>
+
+#include <zypp/base/Easy.h>
+#include <zypp/base/Logger.h>
+#include <zypp/base/Measure.h>
+#include <zypp/base/String.h>
+#include <zypp/sat/Pool.h>
+
+#include "SearchIndex.h"
+#include "utils/ProcessPool.h"
+
+#include "ParallelSearch.h"
+
+using namespace std;
+using namespace zypp;
+
+/** Solvables of the searched repos per worker needed to start one. */
+#define SEARCH_SOLVABLES_PER_JOB 20000
+
+// ---------------------------------------------------------------------------
+
+namespace
+{
+  /** Repos searched by a worker and the number of their solvables. */
+  struct Shard
+  {
+    Shard() : solvables(0) {}
+    set<string> repos;
+    unsigned solvables;
+  };
+
+  bool moreSolvables(const sat::Repository & lhs, const sat::Repository & rhs)
+  { return lhs.solvablesSize() > rhs.solvablesSize(); }
+
+  bool fewerSolvables(const Shard & lhs, const Shard & rhs)
+  { return lhs.solvables < rhs.solvables; }
+
+  /**
+   * The worker: drop the repos of the other shards and pass the ids of
+   * the matching solvables.
+   */
+  int searchShard(const PoolQuery & query, const Shard & shard)
+  {
+    try
+    {
+      vector<string> others;
+      for_(repo, sat::Pool::instance().reposBegin(), sat::Pool::instance().reposEnd())
+        if (shard.repos.find(repo->alias()) == shard.repos.end())
+          others.push_back(repo->alias());
+      for_(alias, others.begin(), others.end())
+        sat::Pool::instance().reposErase(*alias);
+
+      ostringstream ids;
+      for_(it, query.begin(), query.end())
+        ids << it->id() << endl;
+      ProcessPool::jobData(ids.str());
+      return 0;
+    }
+    catch (const Exception & e)
+    {
+      ZYPP_CAUGHT(e);
+      cerr << e.asUserHistory() << endl;
+      return 1;
+    }
+  }
+} // namespace
+
+// ---------------------------------------------------------------------------
+
+void search_solvables(const PoolQuery & query,
+                      set<sat::Solvable> & result,
+                      unsigned jobs)
+{
+  vector<sat::Repository> repos;
+  unsigned solvables = 0;
+  for_(repo, sat::Pool::instance().reposBegin(), sat::Pool::instance().reposEnd())
+    if (searched_repo(*repo, query) && !repo->solvablesEmpty())
+    {
+      repos.push_back(*repo);
+      solvables += repo->solvablesSize();
+    }
+
+  if (jobs == 0)
+  {
+    long cpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+    jobs = min<unsigned>(cpus > 0 ? cpus : 1, solvables / SEARCH_SOLVABLES_PER_JOB);
+  }
+  jobs = min<unsigned>(jobs, repos.size());
+
+  if (jobs < 2)
+  {
+    result.insert(query.begin(), query.end());
+    return;
+  }
+
+  debug::Measure m("search_solvables");
+  MIL << "searching " << repos.size() << " repos (" << solvables
+      << " solvables) using " << jobs << " workers" << endl;
+
+  // biggest repos first, each to the least loaded shard
+  sort(repos.begin(), repos.end(), moreSolvables);
+  vector<Shard> shards(jobs);
+  for_(repo, repos.begin(), repos.end())
+  {
+    Shard & shard(*min_element(shards.begin(), shards.end(), fewerSolvables));
+    shard.repos.insert(repo->alias());
+    shard.solvables += repo->solvablesSize();
+  }
+
+  ProcessPool pool(jobs);
+  vector<unsigned> ids;
+  for_(shard, shards.begin(), shards.end())
+  {
+    const Shard & s(*shard);
+    ids.push_back(pool.start([&query, s]() -> int { return searchShard(query, s); }));
+  }
+
+  set<sat::Solvable> found;
+  bool failed = false;
+  for_(id, ids.begin(), ids.end())
+  {
+    const ProcessPool::Result & res(pool.wait(*id));
+    if (res.status != 0)
+    {
+      WAR << "search worker " << *id << " failed: " << res.output << endl;
+      failed = true;
+      continue;
+    }
+    istringstream data(res.data);
+    for (sat::Solvable::IdType solvable; data >> solvable; )
+      found.insert(sat::Solvable(solvable));
+  }
+
+  // do it ourselves rather than showing partial results
+  if (failed)
+  {
+    result.insert(query.begin(), query.end());
+    return;
+  }
+  result.insert(found.begin(), found.end());
+}
@@ -0,0 +1,36 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#ifndef ZYPPER_PARALLELSEARCH_H_
+#define ZYPPER_PARALLELSEARCH_H_
+
+#include <set>
+
+#include <zypp/PoolQuery.h>
+#include <zypp/sat/Solvable.h>
+
+/**
+ * Add the solvables matching \a query to \a result, evaluating the query
+ * in up to \a jobs worker processes, each searching a share of the repos.
+ *
+ * libzypp is not thread safe, so the workers are forked processes (see
+ * \ref ProcessPool). Each worker drops the repos it doesn't search from
+ * its copy of the pool, runs the query and passes the ids of the matching
+ * solvables back, which stay valid since libsolv doesn't renumber the
+ * solvables of the remaining repos. \a result is ordered by solvable ids,
+ * so the merged result doesn't depend on which worker finishes first.
+ *
+ * With \a jobs == 0 the number of jobs is chosen automatically: one per CPU
+ * if the searched repos are big enough to be worth the fork, none
+ * otherwise. The query is evaluated by this process if only one job would
+ * be used or if any of the workers fails.
+ */
+void search_solvables(const zypp::PoolQuery & query,
+                      std::set<zypp::sat::Solvable> & result,
+                      unsigned jobs = 0);
+
+#endif /* ZYPPER_PARALLELSEARCH_H_ */
@@ -0,0 +1,290 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <zypp/ZYpp.h>
+#include <zypp/ZConfig.h>
+#include <zypp/Digest.h>
+#include <zypp/PathInfo.h>
+#include <zypp/PoolItem.h>
+#include <zypp/sat/Pool.h>
+#include <zypp/base/Easy.h>
+#include <zypp/base/Logger.h>
+#include <zypp/base/Measure.h>
+
+#include "main.h"
+#include "Zypper.h"
+#include "solve-commit.h"
+#include "utils/misc.h"
+
+#include "PoolSnapshot.h"
+
+using namespace std;
+using namespace zypp;
+
+extern ZYpp::Ptr God;
+
+// ---------------------------------------------------------------------------
+
+namespace
+{
+  const char SNAPSHOT_MAGIC[8] = { 'Z', 'Y', 'P', 'P', 'S', 'T', 'A', 'T' };
+  const uint32_t SNAPSHOT_VERSION = 1;
+
+  struct SnapshotHeader
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    /** sha1 of the pool fingerprint in hex, NUL padded */
+    char fingerprint[48];
+  };
+
+  struct SnapshotRecord
+  {
+    uint32_t id;
+    uint32_t bits;
+  };
+
+  enum StatusBits
+  {
+    EST_MASK    = 0x03,
+    SATISFIED   = 0x01,
+    BROKEN      = 0x02,
+    NONRELEVANT = 0x03,
+    ORPHANED    = 0x04,
+    SUGGESTED   = 0x08,
+    RECOMMENDED = 0x10,
+    UNNEEDED    = 0x20
+  };
+
+  uint32_t statusBits(const ResStatus & status)
+  {
+    uint32_t bits = 0;
+    if (status.isSatisfied())
+      bits = SATISFIED;
+    else if (status.isBroken())
+      bits = BROKEN;
+    else if (status.isNonRelevant())
+      bits = NONRELEVANT;
+    if (status.isOrphaned())
+      bits |= ORPHANED;
+    if (status.isSuggested())
+      bits |= SUGGESTED;
+    if (status.isRecommended())
+      bits |= RECOMMENDED;
+    if (status.isUnneeded())
+      bits |= UNNEEDED;
+    return bits;
+  }
+
+  void setStatusBits(ResStatus & status, uint32_t bits)
+  {
+    switch (bits & EST_MASK)
+    {
+    case SATISFIED:   status.setSatisfied(); break;
+    case BROKEN:      status.setBroken(); break;
+    case NONRELEVANT: status.setNonRelevant(); break;
+    default:          status.setUndetermined();
+    }
+    status.setOrphaned(bits & ORPHANED);
+    status.setSuggested(bits & SUGGESTED);
+    status.setRecommended(bits & RECOMMENDED);
+    status.setUnneeded(bits & UNNEEDED);
+  }
+
+  /** Whether the solver run left anything to be installed or removed. */
+  bool poolTransacts()
+  {
+    for_(it, God->pool().begin(), God->pool().end())
+      if (it->status().transacts())
+        return true;
+    return false;
+  }
+
+  /** Apply the snapshot in \a file if it matches \a fingerprint. */
+  bool readSnapshot(const string & file, const string & fingerprint)
+  {
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+      DBG << "no pool snapshot: " << ::strerror(errno) << endl;
+      return false;
+    }
+
+    PathInfo pi(file);
+    size_t size = pi.size();
+    if (size < sizeof(SnapshotHeader))
+    {
+      ::close(fd);
+      WAR << "pool snapshot " << file << " is truncated" << endl;
+      return false;
+    }
+
+    void * addr = ::mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+      WAR << "cannot map " << file << ": " << ::strerror(errno) << endl;
+      return false;
+    }
+
+    const SnapshotHeader * header = static_cast<const SnapshotHeader *>(addr);
+    bool ok = false;
+    if (::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+        || header->version != SNAPSHOT_VERSION
+        || size != sizeof(SnapshotHeader) + header->count * sizeof(SnapshotRecord))
+      WAR << "pool snapshot " << file << " is not valid, ignoring it" << endl;
+    else if (fingerprint.compare(0, string::npos, header->fingerprint,
+                                 ::strnlen(header->fingerprint, sizeof(header->fingerprint))) != 0)
+      DBG << "pool snapshot is outdated" << endl;
+    else
+    {
+      const SnapshotRecord * records =
+        reinterpret_cast<const SnapshotRecord *>(header + 1);
+      unsigned capacity = sat::Pool::instance().capacity();
+      ok = true;
+      for (uint32_t i = 0; i < header->count; ++i)
+      {
+        if (records[i].id >= capacity)
+        {
+          WAR << "pool snapshot refers to solvable " << records[i].id
+              << " which is not in the pool" << endl;
+          ok = false;
+          break;
+        }
+        PoolItem item(sat::Solvable(records[i].id));
+        if (item)
+          setStatusBits(item.status(), records[i].bits);
+      }
+      if (ok)
+        MIL << "applied the status of " << header->count
+            << " solvables from the pool snapshot" << endl;
+    }
+
+    ::munmap(addr, size);
+    return ok;
+  }
+
+  /** Write the current pool status as a snapshot for \a fingerprint. */
+  void writeSnapshot(const string & file, const string & fingerprint)
+  {
+    vector<SnapshotRecord> records;
+    for_(it, God->pool().begin(), God->pool().end())
+    {
+      SnapshotRecord record;
+      record.bits = statusBits(it->status());
+      if (!record.bits)
+        continue;
+      record.id = it->satSolvable().id();
+      records.push_back(record);
+    }
+
+    SnapshotHeader header;
+    ::memset(&header, 0, sizeof(header));
+    ::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.count = records.size();
+    fingerprint.copy(header.fingerprint, sizeof(header.fingerprint) - 1);
+
+    filesystem::assert_dir(Pathname(file).dirname());
+    string tmpfile(file + ".new");
+    {
+      ofstream out(tmpfile.c_str(), ios::binary | ios::trunc);
+      out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      if (!records.empty())
+        out.write(reinterpret_cast<const char *>(&records[0]),
+                  records.size() * sizeof(SnapshotRecord));
+      if (!out)
+      {
+        WAR << "Could not write " << tmpfile << endl;
+        ::unlink(tmpfile.c_str());
+        return;
+      }
+    }
+    if (::rename(tmpfile.c_str(), file.c_str()) != 0)
+    {
+      WAR << "Could not rename " << tmpfile << ": " << ::strerror(errno) << endl;
+      ::unlink(tmpfile.c_str());
+      return;
+    }
+    MIL << "wrote the status of " << records.size()
+        << " solvables to the pool snapshot" << endl;
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+string pool_fingerprint(Zypper & zypper)
+{
+  ostringstream str;
+  const sat::Pool & satpool(sat::Pool::instance());
+  Pathname root(zypper.globalOpts().root_dir);
+
+  str << "root " << root << endl
+      << "arch " << ZConfig::instance().systemArchitecture() << endl
+      << "capacity " << satpool.capacity() << endl;
+
+  for_(it, satpool.reposBegin(), satpool.reposEnd())
+  {
+    str << "repo " << it->alias() << " " << it->solvablesSize()
+        << " " << it->generatedTimestamp().asSeconds();
+    if (it->isSystemRepo())
+      str << " " << rpmdb_stamp(root);
+    else
+      str << " " << zypper.repoManager().metadataStatus(it->info()).checksum();
+    str << endl;
+  }
+
+  str << "locks " << PathInfo(root / ZConfig::instance().locksFile()).mtime() << endl;
+
+  Resolver_Ptr resolver(God->resolver());
+  str << "solver " << resolver->onlyRequires()
+      << " " << resolver->ignoreAlreadyRecommended()
+      << " " << resolver->cleandepsOnRemove()
+      << " " << resolver->forceResolve() << endl;
+
+  istringstream in(str.str());
+  return Digest::digest(Digest::sha1(), in);
+}
+
+// ---------------------------------------------------------------------------
+
+void resolve_status(Zypper & zypper)
+{
+  if (!zypper.config().pool_snapshot)
+  {
+    resolve(zypper);
+    return;
+  }
+
+  debug::Measure m("PoolSnapshot");
+  set_solver_flags(zypper);
+  string fingerprint(pool_fingerprint(zypper));
+  DBG << "pool fingerprint: " << fingerprint << endl;
+
+  if (readSnapshot(ZYPPER_POOL_SNAPSHOT_FILE, fingerprint))
+    return;
+
+  // (re)compute and remember the status for the next time
+  if (resolve(zypper) && !poolTransacts())
+    writeSnapshot(ZYPPER_POOL_SNAPSHOT_FILE, fingerprint);
+  else
+    DBG << "not writing the pool snapshot, the solver did not leave a clean pool" << endl;
+}
@@ -0,0 +1,44 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#ifndef ZYPPER_POOLSNAPSHOT_H_
+#define ZYPPER_POOLSNAPSHOT_H_
+
+#include <string>
+
+class Zypper;
+
+/**
+ * File holding the pool status snapshot (see \ref resolve_status()).
+ *
+ * It consists of a fixed size header with the pool fingerprint followed
+ * by an array of (solvable id, status bits) records, so that it can be
+ * mapped into memory and applied without any parsing.
+ */
+#define ZYPPER_POOL_SNAPSHOT_FILE "/var/cache/zypper/pool-status"
+
+/**
+ * Fingerprint of the loaded pool: the repos in the order they were loaded
+ * along with their metadata cookies, the rpmdb mtime, the locks, the system
+ * architecture and the solver flags. Solvable ids and the computed status
+ * are the same for equal fingerprints.
+ */
+std::string pool_fingerprint(Zypper & zypper);
+
+/**
+ * Compute the status of patches, patterns and products (and the orphaned,
+ * suggested, recommended and unneeded flags) like \ref resolve() does for
+ * the query commands.
+ *
+ * If main.poolSnapshot is enabled in zypper.conf, the status is read from
+ * \ref ZYPPER_POOL_SNAPSHOT_FILE instead of running the solver as long as the
+ * pool fingerprint did not change since it was written, and the file is
+ * rewritten after the solver run otherwise.
+ */
+void resolve_status(Zypper & zypper);
+
+#endif /* ZYPPER_POOLSNAPSHOT_H_ */
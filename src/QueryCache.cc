@@ -0,0 +1,274 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <list>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+#include <unistd.h>
+#include <utime.h>
+
+#include <zypp/ZConfig.h>
+#include <zypp/Digest.h>
+#include <zypp/PathInfo.h>
+#include <zypp/base/Easy.h>
+#include <zypp/base/Logger.h>
+#include <zypp/base/String.h>
+
+#include "main.h"
+#include "Zypper.h"
+#include "utils/console.h"
+#include "utils/misc.h"
+
+#include "QueryCache.h"
+
+using namespace std;
+using namespace zypp;
+
+/** Bump this if the format of the files or the key changes. */
+#define QUERY_CACHE_MAGIC "ZYPPER QUERY CACHE 1"
+/** Number of cached results kept. */
+#define QUERY_CACHE_SIZE 100
+
+// ---------------------------------------------------------------------------
+
+namespace
+{
+  /** The text the cache key is the sha1 of. */
+  string cacheKey(Zypper & zypper)
+  {
+    ostringstream str;
+    const GlobalOptions & gopts(zypper.globalOpts());
+    Pathname root(gopts.root_dir);
+
+    str << QUERY_CACHE_MAGIC << endl
+        << "command " << zypper.command() << endl;
+    for_(opt, zypper.cOpts().begin(), zypper.cOpts().end())
+    {
+      str << "option " << opt->first;
+      for_(value, opt->second.begin(), opt->second.end())
+        str << " '" << *value << "'";
+      str << endl;
+    }
+    for_(arg, zypper.arguments().begin(), zypper.arguments().end())
+      str << "argument '" << *arg << "'" << endl;
+
+    // what the output looks like
+    str << "output " << (zypper.out().type() == Out::TYPE_XML ? "xml" : "normal")
+        << " " << zypper.out().verbosity()
+        << " " << get_screen_width()
+        << " " << ::isatty(STDOUT_FILENO) << endl
+        << "options " << gopts.is_rug_compatible
+        << " " << gopts.disable_system_resolvables
+        << " " << gopts.no_abbrev
+        << " " << gopts.terse << endl
+        << "config " << zypper.config().show_alias
+        << " " << zypper.config().do_colors
+        << " " << zypper.config().solver_installRecommends << endl
+        << "locale " << ZConfig::instance().textLocale() << endl
+        << "arch " << ZConfig::instance().systemArchitecture() << endl;
+
+    // what the pool would be loaded from
+    str << "root " << root << endl;
+    const Pathname & solvcache(gopts.rm_options.repoSolvCachePath);
+    for_(it, zypper.runtimeData().repos.begin(), zypper.runtimeData().repos.end())
+    {
+      str << "repo " << it->alias() << " " << it->enabled()
+          << " " << it->priority() << " '" << it->name() << "'";
+      if (it->enabled())
+        str << " " << zypper.repoManager().metadataStatus(*it).checksum()
+            << " " << file_stamp(solvcache / it->escaped_alias() / "solv");
+      str << endl;
+    }
+    if (!gopts.disable_system_resolvables)
+      str << "rpmdb " << rpmdb_stamp(root) << endl;
+    str << "locks " << file_stamp(root / ZConfig::instance().locksFile()) << endl;
+
+    return str.str();
+  }
+} // namespace
+
+// ---------------------------------------------------------------------------
+
+int QueryCache::TeeBuf::overflow(int c)
+{
+  if (c == traits_type::eof())
+    return _out->pubsync() == 0 ? traits_type::not_eof(c) : traits_type::eof();
+  _written = true;
+  if (_copy)
+    _copy->push_back(traits_type::to_char_type(c));
+  return _out->sputc(traits_type::to_char_type(c));
+}
+
+streamsize QueryCache::TeeBuf::xsputn(const char * s, streamsize n)
+{
+  if (n > 0)
+    _written = true;
+  if (_copy)
+    _copy->append(s, n);
+  return _out->sputn(s, n);
+}
+
+int QueryCache::TeeBuf::sync()
+{ return _out->pubsync(); }
+
+// ---------------------------------------------------------------------------
+
+QueryCache::QueryCache(Zypper & zypper)
+  : _zypper(zypper)
+  , _cout(NULL)
+  , _cerr(NULL)
+{
+  if (!zypper.config().query_cache)
+    return;
+  // --plus-repo repos are gone by the next run
+  if (!zypper.runtimeData().additional_repos.empty())
+  {
+    DBG << "not caching queries with temporary repos" << endl;
+    return;
+  }
+  string dir(user_cache_dir());
+  if (dir.empty())
+    return;
+
+  try
+  {
+    istringstream key(cacheKey(zypper));
+    _file = dir + "/queries/" + Digest::digest(Digest::sha1(), key);
+  }
+  catch (const Exception & e)
+  {
+    ZYPP_CAUGHT(e);
+    WAR << "not using the query cache" << endl;
+  }
+}
+
+QueryCache::~QueryCache()
+{
+  bool recorded = _cout;
+  stop();
+  // not if an exception is on its way
+  if (recorded && !_file.empty() && !std::uncaught_exception())
+    store();
+}
+
+bool QueryCache::replay()
+{
+  if (_file.empty())
+    return false;
+
+  ifstream in(_file.c_str(), ios::binary);
+  if (!in)
+    return false;
+  string magic;
+  int exit_code;
+  if (!getline(in, magic) || magic != QUERY_CACHE_MAGIC || !(in >> exit_code)
+      || in.get() != '\n')
+  {
+    WAR << _file << " is not a zypper query cache" << endl;
+    return false;
+  }
+
+  MIL << "replaying the query result from " << _file << endl;
+  if (in.peek() != ifstream::traits_type::eof())
+    cout << in.rdbuf();
+  cout.flush();
+  _zypper.setExitCode(exit_code);
+  // keep the recently used ones when pruning
+  ::utime(_file.c_str(), NULL);
+  _file.clear();
+  return true;
+}
+
+void QueryCache::record()
+{
+  if (_file.empty() || _cout)
+    return;
+  _cout = new TeeBuf(cout.rdbuf(), &_output);
+  _cerr = new TeeBuf(cerr.rdbuf(), NULL);
+  cout.rdbuf(_cout);
+  cerr.rdbuf(_cerr);
+}
+
+void QueryCache::stop()
+{
+  if (!_cout)
+    return;
+  cout.flush();
+  cout.rdbuf(_cout->out());
+  cerr.rdbuf(_cerr->out());
+  // errors or warnings would not show up again
+  if (_cerr->written())
+  {
+    DBG << "not caching output with errors" << endl;
+    _file.clear();
+  }
+  delete _cout;
+  delete _cerr;
+  _cout = _cerr = NULL;
+}
+
+void QueryCache::store()
+{
+  int exit_code = _zypper.exitCode();
+  if (exit_code != ZYPPER_EXIT_OK && exit_code != ZYPPER_EXIT_INF_CAP_NOT_FOUND)
+    return;
+
+  // don't leave files of root in the home of a user (sudo keeps $HOME)
+  Pathname dir(Pathname(_file).dirname());
+  if (!assert_own_dir(dir))
+  {
+    DBG << "not writing the query cache to " << dir << endl;
+    return;
+  }
+
+  string tmpfile(_file + ".new");
+  {
+    ofstream out(tmpfile.c_str(), ios::binary | ios::trunc);
+    out << QUERY_CACHE_MAGIC << endl << exit_code << endl << _output;
+    if (!out)
+    {
+      WAR << "Could not write " << tmpfile << endl;
+      ::unlink(tmpfile.c_str());
+      return;
+    }
+  }
+  if (::rename(tmpfile.c_str(), _file.c_str()) != 0)
+  {
+    WAR << "Could not rename " << tmpfile << ": " << ::strerror(errno) << endl;
+    ::unlink(tmpfile.c_str());
+    return;
+  }
+  MIL << "wrote the query result to " << _file << endl;
+  prune();
+}
+
+void QueryCache::prune()
+{
+  Pathname dir(Pathname(_file).dirname());
+  list<string> names;
+  if (filesystem::readdir(names, dir, false) != 0
+      || names.size() <= QUERY_CACHE_SIZE)
+    return;
+
+  vector<pair<time_t, string> > files;
+  for_(name, names.begin(), names.end())
+    files.push_back(make_pair(PathInfo(dir / *name).mtime(), *name));
+  sort(files.begin(), files.end());
+  for (unsigned i = 0; i < files.size() - QUERY_CACHE_SIZE; ++i)
+    filesystem::unlink(dir / files[i].second);
+  DBG << "removed " << files.size() - QUERY_CACHE_SIZE
+      << " old query results" << endl;
+}
@@ -0,0 +1,100 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#ifndef ZYPPER_QUERYCACHE_H_
+#define ZYPPER_QUERYCACHE_H_
+
+#include <string>
+#include <streambuf>
+
+#include <zypp/base/NonCopyable.h>
+
+class Zypper;
+
+/**
+ * Output of the query commands (search, what-provides, info) kept in the
+ * user's cache directory ($XDG_CACHE_HOME/zypper/queries or
+ * ~/.cache/zypper/queries), so that the same query on an unchanged system
+ * is answered without loading the pool at all.
+ *
+ * The cache key is a sha1 of the command with its options and arguments,
+ * the output settings (type, verbosity, screen width, colors), the metadata
+ * cookies and solv files of the repos, the state of the rpmdb and the
+ * locks. It is computed from what \ref init_repos() read, before
+ * \ref load_resolvables(). Used only if main.queryCache is enabled in
+ * zypper.conf.
+ *
+ * \code
+ * QueryCache cache(zypper);
+ * if (cache.replay())
+ *   return;
+ * load_resolvables(zypper);
+ * cache.record();
+ * // print the result
+ * \endcode
+ *
+ * The recorded output is stored when the object is destroyed, but only if
+ * the command succeeded (or found nothing) and printed nothing to cerr.
+ */
+class QueryCache : private zypp::base::NonCopyable
+{
+public:
+  QueryCache(Zypper & zypper);
+  ~QueryCache();
+
+  /** Whether the cache is used for this command. */
+  bool enabled() const
+  { return !_file.empty(); }
+
+  /**
+   * Print the cached output and set the exit code of the cached run.
+   * \return whether the output was in the cache
+   */
+  bool replay();
+
+  /** Start recording the output printed to cout. */
+  void record();
+
+private:
+  /** Passes the output on to \a out, keeping a copy in \a copy if set. */
+  class TeeBuf : public std::streambuf
+  {
+  public:
+    TeeBuf(std::streambuf * out, std::string * copy)
+      : _out(out), _copy(copy), _written(false)
+    {}
+
+    std::streambuf * out() const
+    { return _out; }
+
+    bool written() const
+    { return _written; }
+
+  protected:
+    virtual int overflow(int c);
+    virtual std::streamsize xsputn(const char * s, std::streamsize n);
+    virtual int sync();
+
+  private:
+    std::streambuf * _out;
+    std::string * _copy;
+    bool _written;
+  };
+
+  void stop();
+  void store();
+  void prune();
+
+private:
+  Zypper & _zypper;
+  std::string _file;
+  std::string _output;
+  TeeBuf * _cout;
+  TeeBuf * _cerr;
+};
+
+#endif /* ZYPPER_QUERYCACHE_H_ */
@@ -0,0 +1,277 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <ctime>
+
+#include <zypp/base/Easy.h>
+#include <zypp/base/Logger.h>
+#include <zypp/base/String.h>
+#include <zypp/base/Xml.h>
+#include <zypp/ByteCount.h>
+#include <zypp/PathInfo.h>
+
+#include "main.h"
+#include "Zypper.h"
+#include "Table.h"
+#include "utils/text.h"
+
+#include "RefreshStats.h"
+
+using namespace std;
+using namespace zypp;
+
+// ---------------------------------------------------------------------------
+
+static const char * phaseName(RepoRefreshStats::Phase phase)
+{
+  switch (phase)
+  {
+  case RepoRefreshStats::CHECK:    return "check";
+  case RepoRefreshStats::DOWNLOAD: return "download";
+  case RepoRefreshStats::BUILD:    return "build";
+  default: ;
+  }
+  return "";
+}
+
+/** Phase time for the table, empty if the phase did not run. */
+static string timeString(double t)
+{ return t < 0 ? string() : str::form("%.2fs", t); }
+
+// ---------------------------------------------------------------------------
+
+RepoRefreshStats::RepoRefreshStats()
+  : bytes(0), error(false)
+{
+  for (unsigned i = 0; i < PHASE_COUNT; ++i)
+    time[i] = -1;
+}
+
+void RepoRefreshStats::merge(const RepoRefreshStats & other)
+{
+  for (unsigned i = 0; i < PHASE_COUNT; ++i)
+    if (other.time[i] >= 0)
+      time[i] = (time[i] < 0 ? 0 : time[i]) + other.time[i];
+  bytes += other.bytes;
+  if (url.empty())
+    url = other.url;
+  error = error || other.error;
+}
+
+string RepoRefreshStats::serialize() const
+{
+  ostringstream str;
+  for (unsigned i = 0; i < PHASE_COUNT; ++i)
+    str << time[i] << " ";
+  str << bytes << " " << error << " " << url;
+  return str.str();
+}
+
+bool RepoRefreshStats::deserialize(const string & line)
+{
+  istringstream str(line);
+  for (unsigned i = 0; i < PHASE_COUNT; ++i)
+    str >> time[i];
+  str >> bytes >> error >> ws;
+  if (str.fail())
+    return false;
+  getline(str, url);
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+
+RepoRefreshStats & RefreshStats::repo(const RepoInfo & repo)
+{
+  for_(it, _repos.begin(), _repos.end())
+    if (it->alias == repo.alias())
+      return *it;
+
+  _repos.push_back(RepoRefreshStats());
+  _repos.back().alias = repo.alias();
+  _repos.back().name = repo.name();
+  return _repos.back();
+}
+
+void RefreshStats::print(Zypper & zypper) const
+{
+  if (zypper.out().type() == Out::TYPE_XML)
+  {
+    cout << "<refresh-stats>" << endl;
+    for_(it, _repos.begin(), _repos.end())
+    {
+      cout << "<repo alias=\"" << xml::escape(it->alias) << "\""
+           << " name=\"" << xml::escape(it->name) << "\""
+           << " url=\"" << xml::escape(it->url) << "\""
+           << " bytes=\"" << it->bytes << "\""
+           << " error=\"" << it->error << "\">" << endl;
+      for (unsigned i = 0; i < RepoRefreshStats::PHASE_COUNT; ++i)
+        if (it->time[i] >= 0)
+          cout << "<phase name=\"" << phaseName((RepoRefreshStats::Phase) i) << "\""
+               << " time=\"" << it->time[i] << "\"/>" << endl;
+      cout << "</repo>" << endl;
+    }
+    cout << "</refresh-stats>" << endl;
+    return;
+  }
+
+  Table tbl;
+  TableHeader th;
+  th << (zypper.config().show_alias ? _("Alias") : _("Name"))
+     // translators: refresh --stats column - time of the up-to-date check
+     << _("Check")
+     // translators: refresh --stats column - time of the metadata download
+     << _("Download")
+     // translators: refresh --stats column - time of the cache building
+     << _("Build")
+     << _("Total")
+     // translators: refresh --stats column - size of the downloaded data
+     << _("Downloaded")
+     << "URI";
+  tbl << th;
+
+  for_(it, _repos.begin(), _repos.end())
+  {
+    double total = 0;
+    for (unsigned i = 0; i < RepoRefreshStats::PHASE_COUNT; ++i)
+      if (it->time[i] >= 0)
+        total += it->time[i];
+
+    TableRow tr;
+    tr << (zypper.config().show_alias ? it->alias : it->name)
+       << timeString(it->time[RepoRefreshStats::CHECK])
+       << timeString(it->time[RepoRefreshStats::DOWNLOAD])
+       << timeString(it->time[RepoRefreshStats::BUILD])
+       << timeString(total)
+       << (it->bytes ? ByteCount(it->bytes).asString() : string())
+       << it->url;
+    tbl << tr;
+  }
+
+  cout << endl << tbl;
+}
+
+void RefreshStats::dumpAsJsonOn(ostream & out) const
+{
+  out << "{" << endl
+      << "  \"time\": " << ::time(NULL) << "," << endl
+      << "  \"repos\": [";
+  for_(it, _repos.begin(), _repos.end())
+  {
+    out << (it == _repos.begin() ? "" : ",") << endl
+        << "    {" << endl
+        << "      \"alias\": " << json_string(it->alias) << "," << endl
+        << "      \"name\": " << json_string(it->name) << "," << endl
+        << "      \"url\": " << json_string(it->url) << "," << endl;
+    for (unsigned i = 0; i < RepoRefreshStats::PHASE_COUNT; ++i)
+    {
+      out << "      \"" << phaseName((RepoRefreshStats::Phase) i) << "\": ";
+      if (it->time[i] < 0)
+        out << "null";
+      else
+        out << str::form("%.3f", it->time[i]);
+      out << "," << endl;
+    }
+    out << "      \"bytes\": " << it->bytes << "," << endl
+        << "      \"error\": " << (it->error ? "true" : "false") << endl
+        << "    }";
+  }
+  out << endl << "  ]" << endl << "}" << endl;
+}
+
+double RefreshStats::now()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ---------------------------------------------------------------------------
+
+RefreshPhaseTimer::RefreshPhaseTimer(Zypper & zypper, const RepoInfo & repo,
+                                     RepoRefreshStats::Phase phase)
+  : _stats(NULL)
+  , _phase(phase)
+  , _start(0)
+{
+  RefreshStats * stats = zypper.runtimeData().refresh_stats;
+  if (stats)
+  {
+    _stats = &stats->repo(repo);
+    _start = RefreshStats::now();
+  }
+}
+
+RefreshPhaseTimer::~RefreshPhaseTimer()
+{
+  if (!_stats)
+    return;
+  double elapsed = RefreshStats::now() - _start;
+  _stats->time[_phase] = (_stats->time[_phase] < 0 ? 0 : _stats->time[_phase]) + elapsed;
+  DBG << _stats->alias << ": " << phaseName(_phase) << " " << elapsed << "s" << endl;
+}
+
+// ---------------------------------------------------------------------------
+
+RefreshDownloadCounter::RefreshDownloadCounter(RepoRefreshStats & stats)
+  : _stats(stats)
+  , _oldReceiver(Distributor::instance().getReceiver())
+{
+  connect();
+}
+
+RefreshDownloadCounter::~RefreshDownloadCounter()
+{
+  if (_oldReceiver)
+    Distributor::instance().setReceiver(*_oldReceiver);
+  else
+    Distributor::instance().noReceiver();
+}
+
+void RefreshDownloadCounter::start(const Url & file, Pathname localfile)
+{
+  _localfile = localfile;
+  if (_oldReceiver)
+    _oldReceiver->start(file, localfile);
+}
+
+bool RefreshDownloadCounter::progress(int value, const Url & file,
+                                      double dbps_avg, double dbps_current)
+{
+  if (_oldReceiver)
+    return _oldReceiver->progress(value, file, dbps_avg, dbps_current);
+  return true;
+}
+
+RefreshDownloadCounter::Action RefreshDownloadCounter::problem(
+    const Url & file, Error error, const string & description)
+{
+  if (_oldReceiver)
+    return _oldReceiver->problem(file, error, description);
+  return Receiver::problem(file, error, description);
+}
+
+void RefreshDownloadCounter::finish(const Url & file, Error error,
+                                    const string & reason)
+{
+  if (error == NO_ERROR)
+  {
+    _stats.bytes += PathInfo(_localfile).size();
+    // remember where the data came from if the up-to-date check did not tell
+    if (_stats.url.empty())
+    {
+      string url(file.asString());
+      _stats.url = url.substr(0, url.rfind('/') + 1);
+    }
+  }
+
+  if (_oldReceiver)
+    _oldReceiver->finish(file, error, reason);
+}
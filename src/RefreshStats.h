@@ -0,0 +1,133 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#ifndef ZYPPER_REFRESHSTATS_H_
+#define ZYPPER_REFRESHSTATS_H_
+
+#include <string>
+#include <list>
+#include <iosfwd>
+
+#include <zypp/base/NonCopyable.h>
+#include <zypp/RepoInfo.h>
+#include <zypp/ZYppCallbacks.h>
+
+class Zypper;
+
+/**
+ * Wall time spent in the individual phases of a repository refresh,
+ * collected for 'zypper refresh --stats'.
+ */
+struct RepoRefreshStats
+{
+  enum Phase
+  {
+    CHECK,      //!< the up-to-date check
+    DOWNLOAD,   //!< download of raw metadata, including signature checks
+    BUILD,      //!< building of the solv cache
+    PHASE_COUNT
+  };
+
+  RepoRefreshStats();
+
+  /** Add phases and downloads recorded for the same repo elsewhere
+   * (i.e. by a refresh worker process). */
+  void merge(const RepoRefreshStats & other);
+
+  /** One-line representation for passing the stats between processes. */
+  std::string serialize() const;
+  /** Counterpart of \ref serialize(). \return false if \a str is malformed */
+  bool deserialize(const std::string & str);
+
+  std::string alias;
+  std::string name;
+  /** The (mirror) URL the metadata were checked or downloaded from. */
+  std::string url;
+  /** Wall time of the phases in seconds, -1 if the phase did not run. */
+  double time[PHASE_COUNT];
+  /** Number of bytes downloaded. */
+  unsigned long long bytes;
+  bool error;
+};
+
+/**
+ * Refresh statistics of all repos refreshed by a command. Zypper collects
+ * them if \ref RuntimeData::refresh_stats points to an instance.
+ */
+class RefreshStats : private zypp::base::NonCopyable
+{
+public:
+  /** Stats of \a repo, created on first use. */
+  RepoRefreshStats & repo(const zypp::RepoInfo & repo);
+
+  const std::list<RepoRefreshStats> & repos() const
+  { return _repos; }
+
+  /** Print the stats as a table or as an XML element, according to the
+   * output type. */
+  void print(Zypper & zypper) const;
+
+  /** Write the stats as JSON to \a out. */
+  void dumpAsJsonOn(std::ostream & out) const;
+
+  /** Monotonic time in seconds, for measuring the phases. */
+  static double now();
+
+private:
+  /** A list, so that references to the elements remain valid. */
+  std::list<RepoRefreshStats> _repos;
+};
+
+/**
+ * Measures the wall time of a refresh phase from construction to destruction
+ * and adds it to the stats of the repo. Does nothing unless refresh stats are
+ * being collected.
+ */
+class RefreshPhaseTimer : private zypp::base::NonCopyable
+{
+public:
+  RefreshPhaseTimer(Zypper & zypper, const zypp::RepoInfo & repo,
+                    RepoRefreshStats::Phase phase);
+  ~RefreshPhaseTimer();
+
+  /** The stats being recorded into, NULL if not collecting. */
+  RepoRefreshStats * stats() const
+  { return _stats; }
+
+private:
+  RepoRefreshStats * _stats;
+  RepoRefreshStats::Phase _phase;
+  double _start;
+};
+
+/**
+ * Counts the bytes downloaded during its lifetime and records them (and the
+ * URL they came from) in \a stats. The reports are forwarded to the original
+ * receiver.
+ */
+class RefreshDownloadCounter
+  : public zypp::callback::ReceiveReport<zypp::media::DownloadProgressReport>
+{
+public:
+  RefreshDownloadCounter(RepoRefreshStats & stats);
+  ~RefreshDownloadCounter();
+
+  virtual void start(const zypp::Url & file, zypp::Pathname localfile);
+  virtual bool progress(int value, const zypp::Url & file,
+                        double dbps_avg = -1, double dbps_current = -1);
+  virtual Action problem(const zypp::Url & file, Error error,
+                         const std::string & description);
+  virtual void finish(const zypp::Url & file, Error error,
+                      const std::string & reason);
+
+private:
+  RepoRefreshStats & _stats;
+  zypp::Pathname _localfile;
+  Receiver * _oldReceiver;
+};
+
+#endif /* ZYPPER_REFRESHSTATS_H_ */
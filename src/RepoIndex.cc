@@ -0,0 +1,287 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <zypp/base/Easy.h>
+#include <zypp/base/Logger.h>
+#include <zypp/PathInfo.h>
+#include <zypp/RepoInfo.h>
+
+#include "Zypper.h"
+
+#include "RepoIndex.h"
+
+using namespace std;
+using namespace zypp;
+
+// ---------------------------------------------------------------------------
+
+namespace
+{
+  const char INDEX_MAGIC[8] = { 'Z', 'Y', 'P', 'P', 'R', 'I', 'D', 'X' };
+  const uint32_t INDEX_VERSION = 1;
+} // namespace
+
+struct RepoIndex::Header
+{
+  char magic[8];
+  uint32_t version;
+  /** number of solvables in the repository */
+  uint32_t count;
+  /** identity of the solv file the index was built from */
+  uint64_t solv_size;
+  uint64_t solv_mtime;
+  uint64_t solv_ino;
+  uint32_t keys;
+  uint32_t postings;
+  uint32_t strings;
+  uint32_t reserved;
+};
+
+/**
+ * Whether the tables following \a header point into the file: the keys
+ * start within the strings, which end with a NUL, and the solvable lists
+ * are consecutive ranges of the postings. The solvables themselves are
+ * checked when used.
+ */
+bool RepoIndex::consistent(const Header & header,
+                           const uint32_t * keys,
+                           const uint32_t * starts,
+                           const char * strings)
+{
+  if (header.keys && (!header.strings || strings[header.strings - 1] != '\0'))
+    return false;
+  for (uint32_t i = 0; i < header.keys; ++i)
+    if (keys[i] >= header.strings || starts[i] > starts[i + 1])
+      return false;
+  return starts[0] == 0 && starts[header.keys] == header.postings;
+}
+
+// ---------------------------------------------------------------------------
+
+Pathname RepoIndex::solvFile(Zypper & zypper, const sat::Repository & repo)
+{
+  const Pathname & cache(zypper.globalOpts().rm_options.repoSolvCachePath);
+  if (repo.isSystemRepo())
+    return cache / repo.alias() / "solv";
+  return cache / repo.info().escaped_alias() / "solv";
+}
+
+// ---------------------------------------------------------------------------
+
+RepoIndex::RepoIndex(Zypper & zypper, const sat::Repository & repo, const string & name)
+  : _repo(repo)
+  , _addr(NULL)
+  , _size(0)
+  , _header(NULL)
+  , _keys(NULL)
+  , _starts(NULL)
+  , _postings(NULL)
+  , _strings(NULL)
+{
+  Pathname solv(solvFile(zypper, repo));
+  Pathname file(solv.dirname() / name);
+
+  struct stat st;
+  if (::stat(solv.c_str(), &st) != 0)
+    return;
+
+  int fd = ::open(file.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    DBG << "no " << file << ": " << ::strerror(errno) << endl;
+    return;
+  }
+
+  PathInfo pi(file);
+  size_t size = pi.size();
+  if (size < sizeof(Header))
+  {
+    ::close(fd);
+    WAR << file << " is truncated" << endl;
+    return;
+  }
+
+  void * addr = ::mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED)
+  {
+    WAR << "cannot map " << file << ": " << ::strerror(errno) << endl;
+    return;
+  }
+  _addr = addr;
+  _size = size;
+
+  const Header * header = static_cast<const Header *>(addr);
+  if (::memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0
+      || header->version != INDEX_VERSION
+      || size != sizeof(Header)
+                 + (2 * (size_t) header->keys + 1 + header->postings) * sizeof(uint32_t)
+                 + header->strings)
+  {
+    WAR << file << " is not a valid index, ignoring it" << endl;
+    return;
+  }
+  if (header->solv_size != (uint64_t) st.st_size
+      || header->solv_mtime != (uint64_t) st.st_mtime
+      || header->solv_ino != (uint64_t) st.st_ino
+      || header->count != repo.solvablesSize())
+  {
+    DBG << file << " is outdated" << endl;
+    return;
+  }
+
+  const uint32_t * keys = reinterpret_cast<const uint32_t *>(header + 1);
+  const uint32_t * starts = keys + header->keys;
+  const uint32_t * postings = starts + header->keys + 1;
+  const char * strings = reinterpret_cast<const char *>(postings + header->postings);
+  if (!consistent(*header, keys, starts, strings))
+  {
+    WAR << file << " is corrupt, ignoring it" << endl;
+    return;
+  }
+
+  _header = header;
+  _keys = keys;
+  _starts = starts;
+  _postings = postings;
+  _strings = strings;
+  DBG << "using " << file << " (" << header->keys << " keys)" << endl;
+}
+
+RepoIndex::~RepoIndex()
+{
+  if (_addr)
+    ::munmap(_addr, _size);
+}
+
+// ---------------------------------------------------------------------------
+
+unsigned RepoIndex::size() const
+{ return _header ? _header->keys : 0; }
+
+const char * RepoIndex::key(unsigned i) const
+{ return _strings + _keys[i]; }
+
+unsigned RepoIndex::lowerBound(const string & key) const
+{
+  unsigned lo = 0;
+  unsigned hi = size();
+  while (lo < hi)
+  {
+    unsigned mid = lo + (hi - lo) / 2;
+    if (::strcmp(this->key(mid), key.c_str()) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+unsigned RepoIndex::count(unsigned i) const
+{ return _starts[i + 1] - _starts[i]; }
+
+void RepoIndex::solvables(unsigned i, set<sat::Solvable> & result) const
+{
+  if (_solvables.empty())
+  {
+    _solvables.reserve(_header->count);
+    for_(it, _repo.solvablesBegin(), _repo.solvablesEnd())
+      _solvables.push_back(*it);
+  }
+
+  for (uint32_t p = _starts[i]; p < _starts[i + 1]; ++p)
+    if (_postings[p] < _solvables.size())
+      result.insert(_solvables[_postings[p]]);
+}
+
+// ---------------------------------------------------------------------------
+
+bool RepoIndex::writable(Zypper & zypper, const sat::Repository & repo)
+{
+  Pathname solv(solvFile(zypper, repo));
+  return PathInfo(solv).isFile() && ::access(solv.dirname().c_str(), W_OK) == 0;
+}
+
+bool RepoIndex::write(Zypper & zypper, const sat::Repository & repo,
+                      const string & name, const Keys & keys)
+{
+  Pathname solv(solvFile(zypper, repo));
+  Pathname file(solv.dirname() / name);
+
+  struct stat st;
+  if (!writable(zypper, repo) || ::stat(solv.c_str(), &st) != 0)
+  {
+    DBG << "can't write " << file << endl;
+    return false;
+  }
+
+  Header header;
+  ::memset(&header, 0, sizeof(header));
+  ::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  header.version = INDEX_VERSION;
+  header.count = repo.solvablesSize();
+  header.solv_size = st.st_size;
+  header.solv_mtime = st.st_mtime;
+  header.solv_ino = st.st_ino;
+  header.keys = keys.size();
+
+  vector<uint32_t> offsets;
+  vector<uint32_t> starts;
+  vector<uint32_t> postings;
+  string strings;
+  offsets.reserve(keys.size());
+  starts.reserve(keys.size() + 1);
+  for_(it, keys.begin(), keys.end())
+  {
+    offsets.push_back(strings.size());
+    strings.append(it->first.c_str(), it->first.size() + 1);
+    starts.push_back(postings.size());
+    postings.insert(postings.end(), it->second.begin(), it->second.end());
+  }
+  starts.push_back(postings.size());
+  header.postings = postings.size();
+  header.strings = strings.size();
+
+  string tmpfile(file.asString() + ".new");
+  {
+    ofstream out(tmpfile.c_str(), ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (!offsets.empty())
+      out.write(reinterpret_cast<const char *>(&offsets[0]), offsets.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char *>(&starts[0]), starts.size() * sizeof(uint32_t));
+    if (!postings.empty())
+      out.write(reinterpret_cast<const char *>(&postings[0]), postings.size() * sizeof(uint32_t));
+    out.write(strings.data(), strings.size());
+    if (!out)
+    {
+      WAR << "Could not write " << tmpfile << endl;
+      ::unlink(tmpfile.c_str());
+      return false;
+    }
+  }
+  if (::rename(tmpfile.c_str(), file.c_str()) != 0)
+  {
+    WAR << "Could not rename " << tmpfile << ": " << ::strerror(errno) << endl;
+    ::unlink(tmpfile.c_str());
+    return false;
+  }
+  MIL << "wrote " << file << " (" << keys.size() << " keys, "
+      << postings.size() << " entries)" << endl;
+  return true;
+}
@@ -0,0 +1,104 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#ifndef ZYPPER_REPOINDEX_H_
+#define ZYPPER_REPOINDEX_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+#include <stdint.h>
+
+#include <zypp/base/NonCopyable.h>
+#include <zypp/Pathname.h>
+#include <zypp/sat/Repository.h>
+#include <zypp/sat/Solvable.h>
+
+class Zypper;
+
+/**
+ * Index of the solvables of a repository by string keys (words of the
+ * descriptions, file paths, ...), built from the loaded repository and
+ * stored next to its solv file, e.g. /var/cache/zypp/solv/<alias>/<name>.
+ *
+ * The file consists of a fixed size header identifying the solv file it
+ * was built from, the offsets of the sorted keys, the offsets of their
+ * solvable lists, the solvable lists and the NUL terminated keys, so that
+ * it can be mapped into memory and used without any parsing. Solvables are
+ * stored as their position in the repository, which doesn't change while
+ * the solv file stays the same.
+ *
+ * The index is ignored once the solv file changes (or the repository is
+ * loaded with a different number of solvables).
+ */
+class RepoIndex : private zypp::base::NonCopyable
+{
+public:
+  /** Solvables (positions in the repository) by key. */
+  typedef std::map<std::string, std::vector<uint32_t> > Keys;
+
+  /**
+   * Map index \a name of \a repo, if there is a valid one (see
+   * \ref valid()). The repository must be loaded in the pool.
+   */
+  RepoIndex(Zypper & zypper, const zypp::sat::Repository & repo, const std::string & name);
+  ~RepoIndex();
+
+  /** Whether there is an index built from the current solv file. */
+  bool valid() const
+  { return _header != NULL; }
+
+  /** Number of keys. */
+  unsigned size() const;
+
+  /** Key number \a i; the keys are sorted. */
+  const char * key(unsigned i) const;
+
+  /** Number of the first key not less than \a key, \ref size() if none. */
+  unsigned lowerBound(const std::string & key) const;
+
+  /** Number of solvables of key number \a i. */
+  unsigned count(unsigned i) const;
+
+  /** Add the solvables of key number \a i to \a result. */
+  void solvables(unsigned i, std::set<zypp::sat::Solvable> & result) const;
+
+  /** Whether indexes of \a repo can be written (by us). */
+  static bool writable(Zypper & zypper, const zypp::sat::Repository & repo);
+
+  /**
+   * Write index \a name of \a repo holding \a keys, if \ref writable().
+   */
+  static bool write(Zypper & zypper, const zypp::sat::Repository & repo,
+                    const std::string & name, const Keys & keys);
+
+  /** The solv file of \a repo. */
+  static zypp::Pathname solvFile(Zypper & zypper, const zypp::sat::Repository & repo);
+
+private:
+  struct Header;
+
+  static bool consistent(const Header & header,
+                         const uint32_t * keys,
+                         const uint32_t * starts,
+                         const char * strings);
+
+  zypp::sat::Repository _repo;
+  void * _addr;
+  size_t _size;
+  const Header * _header;
+  const uint32_t * _keys;
+  const uint32_t * _starts;
+  const uint32_t * _postings;
+  const char * _strings;
+  /** The solvables of the repository by position, filled when needed. */
+  mutable std::vector<zypp::sat::Solvable> _solvables;
+};
+
+#endif /* ZYPPER_REPOINDEX_H_ */
@@ -15,6 +15,7 @@
 #include "Zypper.h"
 #include "misc.h"
 #include "SolverRequester.h"
+#include "Suggestions.h"
 
 using namespace std;
 using namespace zypp;
@@ -274,8 +275,20 @@ void SolverRequester::Feedback::print(
   {
   case NOT_FOUND_NAME:
   case NOT_FOUND_CAP:
+  {
     out.error(asUserString(opts));
+    // suggest similar names unless wildcards or a file or other capability
+    // than a name were requested
+    string name(_reqpkg.parsed_cap.detail().name().asString());
+    if (_reqpkg.orig_str.find_first_of("?*") == string::npos
+        && name.find_first_of("/()") == string::npos)
+    {
+      sat::Solvable::SplitIdent splid(_reqpkg.parsed_cap.detail().name());
+      print_similar_names(*Zypper::instance(), splid.name().asString(),
+                          _id == NOT_FOUND_NAME ? splid.kind() : ResKind());
+    }
     break;
+  }
   case NOT_FOUND_NAME_TRYING_CAPS:
   case NOT_INSTALLED:
   case NO_INSTALLED_PROVIDER:
@@ -0,0 +1,609 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <algorithm>
+#include <map>
+#include <iterator>
+#include <cstring>
+#include <cctype>
+
+#include <zypp/base/Easy.h>
+#include <zypp/base/Logger.h>
+#include <zypp/base/Measure.h>
+#include <zypp/base/String.h>
+#include <zypp/sat/Pool.h>
+#include <zypp/sat/SolvAttr.h>
+#include <zypp/sat/LookupAttr.h>
+#include <zypp/base/StrMatcher.h>
+
+#include "Zypper.h"
+#include "RepoIndex.h"
+
+#include "SearchIndex.h"
+
+using namespace std;
+using namespace zypp;
+
+#define DESC_INDEX "descindex"
+#define NAME_INDEX "nameindex"
+#define PATH_INDEX "pathindex"
+
+// ---------------------------------------------------------------------------
+
+namespace
+{
+  /** Bytes of UTF-8 characters count as word characters. */
+  inline bool isWordChar(unsigned char c)
+  { return ::isalnum(c) || c >= 0x80; }
+
+  /** Add the words of \a text, lowercased, to \a result. */
+  void words(const char * text, set<string> & result)
+  {
+    if (!text)
+      return;
+    const char * p = text;
+    while (*p)
+    {
+      while (*p && !isWordChar(*p))
+        ++p;
+      const char * start = p;
+      while (*p && isWordChar(*p))
+        ++p;
+      if (p != start)
+        result.insert(str::toLower(string(start, p - start)));
+    }
+  }
+
+  /** Whether \a term consists of word characters only. */
+  bool isWord(const string & term)
+  {
+    if (term.empty())
+      return false;
+    for_(it, term.begin(), term.end())
+      if (!isWordChar(*it))
+        return false;
+    return true;
+  }
+
+  /**
+   * Whether \a text matches \a term the way the PoolQuery would (substring,
+   * word or exact match). Both are lowercased already unless the search is
+   * case sensitive.
+   */
+  bool textMatches(const string & text, const string & term, const PoolQuery & query)
+  {
+    if (query.matchExact())
+      return text == term;
+
+    for (string::size_type pos = text.find(term); pos != string::npos;
+         pos = text.find(term, pos + 1))
+    {
+      if (!query.matchWord())
+        return true;
+      string::size_type end = pos + term.size();
+      if ((pos == 0 || !isWordChar(text[pos - 1]))
+          && (end == text.size() || !isWordChar(text[end])))
+        return true;
+    }
+    return false;
+  }
+
+  /** Add the trigrams of \a text, lowercased, to \a result. */
+  void trigrams(const string & text, set<string> & result)
+  {
+    string lower(str::toLower(text));
+    for (string::size_type i = 0; i + 3 <= lower.size(); ++i)
+      result.insert(lower.substr(i, 3));
+  }
+
+  /** Add the components of \a path, lowercased, to \a result. */
+  void components(const string & path, set<string> & result)
+  {
+    string::size_type start = 0;
+    while (start < path.size())
+    {
+      string::size_type end = path.find('/', start);
+      if (end == string::npos)
+        end = path.size();
+      if (end > start)
+        result.insert(str::toLower(path.substr(start, end - start)));
+      start = end + 1;
+    }
+  }
+
+  /** Number of \a key in \a index, \ref RepoIndex::size() if not there. */
+  unsigned findKey(const RepoIndex & index, const string & key)
+  {
+    unsigned i = index.lowerBound(key);
+    if (i < index.size() && key == index.key(i))
+      return i;
+    return index.size();
+  }
+
+  /** Whether \a solvable is of a kind searched by \a query. */
+  bool searchedKind(const sat::Solvable & solvable, const PoolQuery & query)
+  { return query.kinds().empty() || query.kinds().find(solvable.kind()) != query.kinds().end(); }
+
+  /** Attribute \a attr of \a solvable, lowercased if \a lower. */
+  string solvableText(const sat::Solvable & solvable, sat::SolvAttr attr, bool lower)
+  {
+    string text(solvable.lookupStrAttribute(attr));
+    return lower ? str::toLower(text) : text;
+  }
+
+  /** The keys of the index \a name of \a solvable. */
+  void indexKeys(const sat::Solvable & solvable, const string & name, set<string> & result)
+  {
+    if (name == DESC_INDEX)
+    {
+      words(solvable.lookupStrAttribute(sat::SolvAttr::summary).c_str(), result);
+      words(solvable.lookupStrAttribute(sat::SolvAttr::description).c_str(), result);
+    }
+    else if (name == NAME_INDEX)
+      trigrams(solvable.name(), result);
+    else if (name == PATH_INDEX)
+    {
+      sat::LookupAttr files(sat::SolvAttr::filelist, solvable);
+      for_(file, files.begin(), files.end())
+        components(file.asString(), result);
+    }
+  }
+
+  /**
+   * Write the index \a name of \a repo unless it is up to date, e.g. only
+   * the name index for a search by name.
+   */
+  void updateIndex(Zypper & zypper, const sat::Repository & repo, const string & name)
+  {
+    if (!RepoIndex::writable(zypper, repo) || RepoIndex(zypper, repo, name).valid())
+      return;
+
+    debug::Measure m(name + " " + repo.alias());
+    RepoIndex::Keys keys;
+    uint32_t pos = 0;
+    for_(it, repo.solvablesBegin(), repo.solvablesEnd())
+    {
+      set<string> solvable_keys;
+      indexKeys(*it, name, solvable_keys);
+      for_(key, solvable_keys.begin(), solvable_keys.end())
+        keys[*key].push_back(pos);
+      ++pos;
+    }
+    RepoIndex::write(zypper, repo, name, keys);
+  }
+} // namespace
+
+// ---------------------------------------------------------------------------
+
+bool required_trigrams(const string & term, const PoolQuery & query, set<string> & result)
+{
+  if (!query.matchGlob() && !query.matchRegex())
+  {
+    trigrams(term, result);
+    return !result.empty();
+  }
+  if (query.matchRegex() && term.find('|') != string::npos)
+    return false;
+
+  const char * special = query.matchGlob() ? "*?[\\" : ".^$*+?{}[]()\\|";
+  string literal;
+  for (string::size_type i = 0; i <= term.size(); ++i)
+  {
+    char c = i < term.size() ? term[i] : '\0';
+    if (c && !::strchr(special, c))
+    {
+      literal += c;
+      continue;
+    }
+    // the previous character is optional
+    if (query.matchRegex() && !literal.empty() && (c == '*' || c == '?' || c == '{'))
+      literal.erase(literal.size() - 1);
+    trigrams(literal, result);
+    literal.clear();
+
+    // skip bracket expressions, repetition counts, escaped characters
+    // and groups
+    if (c == '[' || (c == '{' && query.matchRegex()))
+    {
+      string::size_type end = term.find(c == '[' ? ']' : '}', i + 2);
+      i = end == string::npos ? term.size() : end;
+    }
+    else if (c == '\\')
+      ++i;
+    else if (c == '(' && query.matchRegex())
+    {
+      for (unsigned depth = 1; depth && ++i < term.size(); )
+        if (term[i] == '\\')
+          ++i;
+        else if (term[i] == '(')
+          ++depth;
+        else if (term[i] == ')')
+          --depth;
+    }
+  }
+  return !result.empty();
+}
+
+bool required_components(const string & term, const PoolQuery & query,
+                         vector<ComponentLookup> & result)
+{
+  if (query.matchRegex())
+    return false;
+
+  string literal(term);
+  bool whole = query.matchExact();
+  if (query.matchGlob())
+  {
+    literal = term.substr(0, term.find_first_of("*?[\\"));
+    whole = literal == term;
+  }
+
+  vector<string> parts;
+  string::size_type start = 0;
+  for (string::size_type end; (end = literal.find('/', start)) != string::npos; start = end + 1)
+    parts.push_back(literal.substr(start, end - start));
+  parts.push_back(literal.substr(start));
+  for (unsigned i = 1; i < parts.size(); ++i)
+  {
+    if (parts[i].empty())
+      continue;
+    bool last = i + 1 == parts.size();
+    result.push_back(ComponentLookup(parts[i], last && !whole));
+  }
+  return !result.empty();
+}
+
+// ---------------------------------------------------------------------------
+
+void update_search_indexes(Zypper & zypper, const sat::Repository & repo)
+{
+  updateIndex(zypper, repo, DESC_INDEX);
+  updateIndex(zypper, repo, NAME_INDEX);
+  updateIndex(zypper, repo, PATH_INDEX);
+}
+
+// ---------------------------------------------------------------------------
+
+bool search_descriptions(Zypper & zypper,
+                         const PoolQuery & query,
+                         const vector<string> & terms,
+                         set<sat::Solvable> & result,
+                         set<string> & unindexed)
+{
+  if (query.matchGlob() || query.matchRegex())
+    return false;
+
+  bool lower = !query.caseSensitive();
+  vector<string> keys;        // lowercased, as in the index
+  vector<string> match_terms; // as matched against the texts
+  for_(it, terms.begin(), terms.end())
+  {
+    if (!isWord(*it))
+    {
+      DBG << "can't use the description index for '" << *it << "'" << endl;
+      return false;
+    }
+    keys.push_back(str::toLower(*it));
+    match_terms.push_back(lower ? keys.back() : *it);
+  }
+
+  debug::Measure m("search_descriptions");
+  bool substring = !query.matchWord() && !query.matchExact();
+
+  for_(repo, sat::Pool::instance().reposBegin(), sat::Pool::instance().reposEnd())
+  {
+    if (!searched_repo(*repo, query))
+      continue;
+
+    updateIndex(zypper, *repo, DESC_INDEX);
+    RepoIndex index(zypper, *repo, DESC_INDEX);
+    if (!index.valid())
+    {
+      unindexed.insert(repo->alias());
+      continue;
+    }
+
+    // solvables using a word matching any of the terms
+    set<sat::Solvable> candidates;
+    for_(key, keys.begin(), keys.end())
+    {
+      if (substring)
+      {
+        for (unsigned i = 0; i < index.size(); ++i)
+          if (::strstr(index.key(i), key->c_str()))
+            index.solvables(i, candidates);
+      }
+      else
+      {
+        unsigned i = findKey(index, *key);
+        if (i < index.size())
+          index.solvables(i, candidates);
+      }
+    }
+
+    // now the real match on the candidates
+    for_(it, candidates.begin(), candidates.end())
+    {
+      if (!searchedKind(*it, query))
+        continue;
+
+      string summary(solvableText(*it, sat::SolvAttr::summary, lower));
+      string description(solvableText(*it, sat::SolvAttr::description, lower));
+      for_(term, match_terms.begin(), match_terms.end())
+        if (textMatches(summary, *term, query) || textMatches(description, *term, query))
+        {
+          result.insert(*it);
+          break;
+        }
+    }
+  }
+
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+
+bool search_names(Zypper & zypper,
+                  const PoolQuery & query,
+                  const vector<string> & terms,
+                  set<sat::Solvable> & result,
+                  set<string> & unindexed)
+{
+  vector<set<string> > term_trigrams(terms.size());
+  for (unsigned t = 0; t < terms.size(); ++t)
+    if (!required_trigrams(terms[t], query, term_trigrams[t]))
+    {
+      DBG << "can't use the name index for '" << terms[t] << "'" << endl;
+      return false;
+    }
+
+  // throws on invalid regexes like the PoolQuery would
+  Match flags(query.flags());
+  flags -= Match::FILES;
+  vector<StrMatcher> matchers;
+  for_(term, terms.begin(), terms.end())
+  {
+    matchers.push_back(StrMatcher(*term, flags));
+    matchers.back().compile();
+  }
+
+  debug::Measure m("search_names");
+  for_(repo, sat::Pool::instance().reposBegin(), sat::Pool::instance().reposEnd())
+  {
+    if (!searched_repo(*repo, query))
+      continue;
+
+    updateIndex(zypper, *repo, NAME_INDEX);
+    RepoIndex index(zypper, *repo, NAME_INDEX);
+    if (!index.valid())
+    {
+      unindexed.insert(repo->alias());
+      continue;
+    }
+
+    // solvables whose names contain all trigrams of any of the terms
+    set<sat::Solvable> candidates;
+    for_(tt, term_trigrams.begin(), term_trigrams.end())
+    {
+      set<sat::Solvable> term_candidates;
+      for_(trigram, tt->begin(), tt->end())
+      {
+        unsigned i = findKey(index, *trigram);
+        if (i == index.size())
+        {
+          term_candidates.clear();
+          break;
+        }
+        set<sat::Solvable> solvables;
+        index.solvables(i, solvables);
+        if (trigram == tt->begin())
+          term_candidates.swap(solvables);
+        else
+        {
+          set<sat::Solvable> both;
+          set_intersection(term_candidates.begin(), term_candidates.end(),
+                           solvables.begin(), solvables.end(),
+                           inserter(both, both.begin()));
+          term_candidates.swap(both);
+        }
+        if (term_candidates.empty())
+          break;
+      }
+      candidates.insert(term_candidates.begin(), term_candidates.end());
+    }
+
+    // now the real match on the candidates
+    for_(it, candidates.begin(), candidates.end())
+    {
+      if (!searchedKind(*it, query))
+        continue;
+
+      string name(it->name());
+      for_(matcher, matchers.begin(), matchers.end())
+        if (matcher->doMatch(name.c_str()))
+        {
+          result.insert(*it);
+          break;
+        }
+    }
+  }
+
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+
+bool search_paths(Zypper & zypper,
+                  const PoolQuery & query,
+                  const vector<string> & terms,
+                  set<sat::Solvable> & result,
+                  set<string> & unindexed)
+{
+  vector<vector<ComponentLookup> > term_components(terms.size());
+  for (unsigned t = 0; t < terms.size(); ++t)
+    if (!required_components(terms[t], query, term_components[t]))
+    {
+      DBG << "can't use the path index for '" << terms[t] << "'" << endl;
+      return false;
+    }
+
+  // full paths are matched, not the base names
+  Match flags(query.flags());
+  flags -= Match::FILES;
+  vector<StrMatcher> matchers;
+  for_(term, terms.begin(), terms.end())
+  {
+    matchers.push_back(StrMatcher(*term, flags));
+    matchers.back().compile();
+  }
+
+  debug::Measure m("search_paths");
+  for_(repo, sat::Pool::instance().reposBegin(), sat::Pool::instance().reposEnd())
+  {
+    if (!searched_repo(*repo, query))
+      continue;
+
+    updateIndex(zypper, *repo, PATH_INDEX);
+    RepoIndex index(zypper, *repo, PATH_INDEX);
+    if (!index.valid())
+    {
+      unindexed.insert(repo->alias());
+      continue;
+    }
+
+    // the solvables having the least common of the components of a term
+    set<sat::Solvable> candidates;
+    for_(tc, term_components.begin(), term_components.end())
+    {
+      unsigned best_begin = 0, best_end = 0, best_count = 0;
+      for_(lookup, tc->begin(), tc->end())
+      {
+        unsigned begin = index.lowerBound(lookup->key);
+        unsigned end = begin, count = 0;
+        while (end < index.size()
+               && (lookup->prefix ? str::hasPrefix(index.key(end), lookup->key)
+                                  : lookup->key == index.key(end)))
+          count += index.count(end++);
+        if (lookup == tc->begin() || count < best_count)
+        {
+          best_begin = begin;
+          best_end = end;
+          best_count = count;
+        }
+      }
+      for (unsigned i = best_begin; i < best_end; ++i)
+        index.solvables(i, candidates);
+    }
+
+    // now the real match on the files of the candidates
+    for_(it, candidates.begin(), candidates.end())
+    {
+      if (!searchedKind(*it, query))
+        continue;
+
+      sat::LookupAttr files(sat::SolvAttr::filelist, *it);
+      bool found = false;
+      for_(file, files.begin(), files.end())
+      {
+        string path(file.asString());
+        for_(matcher, matchers.begin(), matchers.end())
+          if (matcher->doMatch(path.c_str()))
+          {
+            found = true;
+            break;
+          }
+        if (found)
+        {
+          result.insert(*it);
+          break;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+
+void search_similar_names(Zypper & zypper,
+                          const string & name,
+                          unsigned min_shared,
+                          set<sat::Solvable> & result,
+                          set<string> & unindexed)
+{
+  // a repeated trigram counts as often as it occurs in the name
+  map<string, unsigned> name_trigrams;
+  string lower(str::toLower(name));
+  for (string::size_type i = 0; i + 3 <= lower.size(); ++i)
+    ++name_trigrams[lower.substr(i, 3)];
+
+  for_(repo, sat::Pool::instance().reposBegin(), sat::Pool::instance().reposEnd())
+  {
+    updateIndex(zypper, *repo, NAME_INDEX);
+    RepoIndex index(zypper, *repo, NAME_INDEX);
+    if (!index.valid())
+    {
+      unindexed.insert(repo->alias());
+      continue;
+    }
+
+    map<sat::Solvable, unsigned> shared;
+    for_(trigram, name_trigrams.begin(), name_trigrams.end())
+    {
+      unsigned i = findKey(index, trigram->first);
+      if (i == index.size())
+        continue;
+      set<sat::Solvable> solvables;
+      index.solvables(i, solvables);
+      for_(it, solvables.begin(), solvables.end())
+        shared[*it] += trigram->second;
+    }
+    for_(it, shared.begin(), shared.end())
+      if (it->second >= min_shared)
+        result.insert(it->first);
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+bool searched_repo(const sat::Repository & repo, const PoolQuery & query)
+{
+  if (!query.repos().empty() && query.repos().find(repo.alias()) == query.repos().end())
+    return false;
+  if ((query.statusFilterFlags() & PoolQuery::UNINSTALLED_ONLY) && repo.isSystemRepo())
+    return false;
+  return true;
+}
+
+PoolQuery search_query(const PoolQuery & query, const set<string> & repos)
+{
+  PoolQuery result;
+  result.setFlags(query.flags());
+  result.setStatusFilterFlags(query.statusFilterFlags());
+  for_(it, query.kinds().begin(), query.kinds().end())
+    result.addKind(*it);
+  for_(it, repos.begin(), repos.end())
+    result.addRepo(*it);
+  return result;
+}
+
+// ---------------------------------------------------------------------------
+
+vector<ui::Selectable::constPtr> search_selectables(const set<sat::Solvable> & solvables)
+{
+  vector<ui::Selectable::constPtr> result;
+  set<ui::Selectable::constPtr> seen;
+  for_(it, solvables.begin(), solvables.end())
+  {
+    ui::Selectable::constPtr sel(ui::Selectable::get(*it));
+    if (sel && seen.insert(sel).second)
+      result.push_back(sel);
+  }
+  return result;
+}
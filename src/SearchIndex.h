@@ -0,0 +1,173 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+/**
+ * Per repository indexes (see \ref RepoIndex) used by zypper search instead
+ * of matching the strings of every solvable in the pool:
+ *
+ * descindex - the words of the summaries and descriptions, lowercased
+ *             (search --search-descriptions)
+ * nameindex - the trigrams (three byte substrings) of the names, lowercased
+ *             (substring, glob and regex searches by name)
+ * pathindex - the components of the paths in the file lists, lowercased
+ *             (search --file-list and --provides /path)
+ *
+ * The indexes are written when the repository cache is built by refresh,
+ * or by the first search needing them if the cache directory is writable.
+ */
+#ifndef ZYPPER_SEARCHINDEX_H_
+#define ZYPPER_SEARCHINDEX_H_
+
+#include <string>
+#include <vector>
+#include <set>
+
+#include <zypp/base/String.h>
+#include <zypp/PoolQuery.h>
+#include <zypp/sat/Repository.h>
+#include <zypp/sat/Solvable.h>
+#include <zypp/ui/Selectable.h>
+
+class Zypper;
+
+/**
+ * Write all the search indexes of \a repo (loaded in the pool) unless up to
+ * date. The searches write only the index they use.
+ */
+void update_search_indexes(Zypper & zypper, const zypp::sat::Repository & repo);
+
+/**
+ * Search the summaries and descriptions for any of \a terms, with the match
+ * mode and the kind, repo and status filters of \a query, using the
+ * description indexes.
+ *
+ * The matches in the indexed repos are added to \a result. The aliases of
+ * the repos without a usable index are added to \a unindexed, these need
+ * to be searched by a PoolQuery.
+ *
+ * \return false if the index can't answer the search (glob or regex
+ *         matching, terms with spaces or punctuation), nothing is searched
+ *         then
+ */
+bool search_descriptions(Zypper & zypper,
+                         const zypp::PoolQuery & query,
+                         const std::vector<std::string> & terms,
+                         std::set<zypp::sat::Solvable> & result,
+                         std::set<std::string> & unindexed);
+
+/**
+ * Search the names for any of \a terms, with the match mode and the kind,
+ * repo and status filters of \a query, using the name indexes. The index
+ * narrows the candidates down to the names containing all the trigrams of
+ * a term (of its literal parts in case of globs and regexes), these are
+ * then matched like PoolQuery does.
+ *
+ * The matches in the indexed repos are added to \a result. The aliases of
+ * the repos without a usable index are added to \a unindexed, these need
+ * to be searched by a PoolQuery.
+ *
+ * \return false if the index can't answer the search (terms shorter than
+ *         three characters, regexes with alternatives), nothing is searched
+ *         then
+ * \throws MatchException if a term is an invalid regex
+ */
+bool search_names(Zypper & zypper,
+                  const zypp::PoolQuery & query,
+                  const std::vector<std::string> & terms,
+                  std::set<zypp::sat::Solvable> & result,
+                  std::set<std::string> & unindexed);
+
+/**
+ * Search the file lists for any of the paths \a terms, with the match mode
+ * and the kind, repo and status filters of \a query, using the path indexes.
+ * The index narrows the candidates down to the solvables having the least
+ * common of the components a matching path must have (e.g. the ones having
+ * a path component starting with 'libfoo' for /usr/lib64/libfoo*),
+ * then their file lists are matched like PoolQuery does with full paths.
+ *
+ * The matches in the indexed repos are added to \a result. The aliases of
+ * the repos without a usable index are added to \a unindexed, these need
+ * to be searched by a PoolQuery.
+ *
+ * \return false if the index can't answer the search (regexes, globs
+ *         starting with a wildcard, terms without slashes), nothing is
+ *         searched then
+ */
+bool search_paths(Zypper & zypper,
+                  const zypp::PoolQuery & query,
+                  const std::vector<std::string> & terms,
+                  std::set<zypp::sat::Solvable> & result,
+                  std::set<std::string> & unindexed);
+
+/**
+ * Add the solvables of all repos whose names share at least \a min_shared
+ * trigrams with \a name (lowercased) to \a result, using the name indexes.
+ * A trigram occurring several times in \a name counts that many times, so
+ * this is never less than the shared trigrams counted as a multiset.
+ * The aliases of the repos without a usable index are added to
+ * \a unindexed.
+ */
+void search_similar_names(Zypper & zypper,
+                          const std::string & name,
+                          unsigned min_shared,
+                          std::set<zypp::sat::Solvable> & result,
+                          std::set<std::string> & unindexed);
+
+/**
+ * The trigrams every name matching \a term must contain, according to the
+ * match mode of \a query, added to \a result. Only the literal parts of
+ * globs and regexes are used: the characters outside of brackets and groups
+ * and not followed by a repetition. Regexes with alternatives are not
+ * handled.
+ *
+ * \return false if there are no such trigrams (the term is too short)
+ */
+bool required_trigrams(const std::string & term,
+                       const zypp::PoolQuery & query,
+                       std::set<std::string> & result);
+
+/** A path component to look up in the path index. */
+struct ComponentLookup
+{
+  ComponentLookup(const std::string & key_r, bool prefix_r)
+    : key(zypp::str::toLower(key_r)), prefix(prefix_r) {}
+
+  std::string key;
+  /** whether \a key is only a prefix of the component */
+  bool prefix;
+};
+
+/**
+ * The components every path matching \a term must have, according to
+ * the match mode of \a query, added to \a result. Parts of the term between
+ * slashes are whole components, the last part is the beginning of one
+ * unless the whole path must match. The first part of a substring may be
+ * the end of a component and is not used. Globs are used up to the first
+ * wildcard.
+ *
+ * \return false if there are no such components (regexes, terms without
+ *         slashes)
+ */
+bool required_components(const std::string & term,
+                         const zypp::PoolQuery & query,
+                         std::vector<ComponentLookup> & result);
+
+/** Whether the solvables of \a repo are searched by \a query. */
+bool searched_repo(const zypp::sat::Repository & repo, const zypp::PoolQuery & query);
+
+/**
+ * A query with the match mode and the kind and status filters of \a query,
+ * searching only \a repos, to search the repos without indexes.
+ */
+zypp::PoolQuery search_query(const zypp::PoolQuery & query,
+                             const std::set<std::string> & repos);
+
+/** The selectables of \a solvables, in the order of their first solvable. */
+std::vector<zypp::ui::Selectable::constPtr> search_selectables(
+    const std::set<zypp::sat::Solvable> & solvables);
+
+#endif /* ZYPPER_SEARCHINDEX_H_ */
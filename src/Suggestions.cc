@@ -0,0 +1,129 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include <boost/format.hpp>
+
+#include <zypp/base/Easy.h>
+#include <zypp/base/Logger.h>
+#include <zypp/base/Measure.h>
+#include <zypp/base/String.h>
+#include <zypp/sat/Pool.h>
+
+#include "main.h"
+#include "Zypper.h"
+#include "SearchIndex.h"
+#include "utils/EditDistance.h"
+
+#include "Suggestions.h"
+
+using namespace std;
+using namespace zypp;
+using boost::format;
+
+// ---------------------------------------------------------------------------
+
+namespace
+{
+  /** Maximum edit distance of suggestions for a name of length \a size. */
+  unsigned maxDistance(unsigned size)
+  {
+    if (size <= 4)
+      return 1;
+    if (size <= 8)
+      return 2;
+    return 3;
+  }
+
+  /**
+   * Trigrams a name of length \a size must share with the names within edit
+   * distance \a dist of it to be a candidate: (size - 2 - 3 * dist), since
+   * an edit changes at most three of them, but at least one. The latter
+   * misses the rare short names within the distance sharing no trigram at
+   * all, rather than scanning the whole pool for every short name.
+   */
+  unsigned requiredSharedTrigrams(unsigned size, unsigned dist)
+  {
+    int bound = int(size) - 2 - 3 * int(dist);
+    return bound > 1 ? bound : 1;
+  }
+} // namespace
+
+// ---------------------------------------------------------------------------
+
+vector<string> similar_names(Zypper & zypper, const string & name,
+                             const ResKind & kind, unsigned max)
+{
+  debug::Measure m("similar_names");
+  string lname(str::toLower(name));
+  unsigned max_dist = maxDistance(lname.size());
+  EditDistance distance(lname);
+
+  // the candidates: solvables sharing enough trigrams with the name or in
+  // repos without index; names without trigrams (shorter than three
+  // characters) can only be found by scanning
+  set<sat::Solvable> candidates;
+  set<string> unindexed;
+  bool scan_all = lname.size() < 3;
+  if (!scan_all)
+    search_similar_names(zypper, lname, requiredSharedTrigrams(lname.size(), max_dist),
+                         candidates, unindexed);
+  for_(repo, sat::Pool::instance().reposBegin(), sat::Pool::instance().reposEnd())
+    if (scan_all || unindexed.find(repo->alias()) != unindexed.end())
+      candidates.insert(repo->solvablesBegin(), repo->solvablesEnd());
+
+  map<string, unsigned> found;
+  for_(it, candidates.begin(), candidates.end())
+  {
+    if (kind != ResKind() && !it->isKind(kind))
+      continue;
+    string cname(it->name());
+    if (cname == name || found.find(cname) != found.end())
+      continue;
+    // cheap length check first
+    unsigned diff = cname.size() > lname.size() ? cname.size() - lname.size()
+                                                 : lname.size() - cname.size();
+    if (diff > max_dist)
+      continue;
+    unsigned dist = distance(str::toLower(cname));
+    if (dist <= max_dist)
+      found[cname] = dist;
+  }
+
+  vector<pair<unsigned, string> > sorted;
+  for_(it, found.begin(), found.end())
+    sorted.push_back(make_pair(it->second, it->first));
+  sort(sorted.begin(), sorted.end());
+
+  vector<string> result;
+  for (unsigned i = 0; i < sorted.size() && i < max; ++i)
+    result.push_back(sorted[i].second);
+  DBG << "similar to '" << name << "' (" << candidates.size() << " candidates): "
+      << result.size() << endl;
+  return result;
+}
+
+void print_similar_names(Zypper & zypper, const string & name, const ResKind & kind)
+{
+  vector<string> names(similar_names(zypper, name, kind));
+  if (names.empty())
+    return;
+
+  string list;
+  for_(it, names.begin(), names.end())
+  {
+    if (!list.empty())
+      list += ", ";
+    list += "'" + *it + "'";
+  }
+  // translators: %s is a list of package names, e.g. 'zypper', 'zypp'
+  zypper.out().info(boost::str(format(_("Did you mean %s?")) % list));
+}
@@ -0,0 +1,48 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+/**
+ * "Did you mean" suggestions for names not found in the pool.
+ */
+#ifndef ZYPPER_SUGGESTIONS_H_
+#define ZYPPER_SUGGESTIONS_H_
+
+#include <string>
+#include <vector>
+
+#include <zypp/ResKind.h>
+
+class Zypper;
+
+/**
+ * Names of \a kind (any kind if empty) in the pool closest to \a name by
+ * edit distance (ignoring case), best first, at most \a max of them. Only
+ * names within a distance of 1 to 3, depending on the length of \a name,
+ * are considered.
+ *
+ * Candidates are taken from the name indexes of the repos (see
+ * \ref search_similar_names()): a name within distance d shares at least
+ * (length - 2 - 3 * d) trigrams with \a name, since an edit changes at most
+ * three of them, and at least one trigram is required. Repos without an
+ * index and names shorter than three characters are scanned. The distances
+ * are computed by the bit-parallel algorithm of Myers, which handles all the
+ * columns of a pattern in one machine word at once.
+ */
+std::vector<std::string> similar_names(Zypper & zypper,
+                                       const std::string & name,
+                                       const zypp::ResKind & kind = zypp::ResKind(),
+                                       unsigned max = 3);
+
+/**
+ * Print "Did you mean ...?" with the \ref similar_names() of \a name,
+ * if there are any.
+ */
+void print_similar_names(Zypper & zypper,
+                         const std::string & name,
+                         const zypp::ResKind & kind = zypp::ResKind());
+
+#endif /* ZYPPER_SUGGESTIONS_H_ */
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <cstring>
 #include <cstdlib>
+#include <algorithm>
 
 #include <zypp/base/LogTools.h>
 #include <zypp/base/String.h>
@@ -9,6 +10,7 @@
 #include "utils/colors.h"
 #include "utils/console.h"
 #include "utils/text.h"
+#include "utils/Profiler.h"
 
 #include "Zypper.h"
 #include "Table.h"
@@ -63,12 +65,103 @@ void TableRow::dumbDumpTo (ostream &stream) const {
   stream << endl;
 }
 
-void TableRow::dumpDetails(ostream &stream, const Table & parent) const
+void TableRow::dumpTo (ostream &stream, const Table & parent) const
+{
+  vector<Table::CellRef> cells;
+  cells.reserve (_columns.size());
+  for_( it, _columns.begin(), _columns.end() )
+  {
+    Table::CellRef cell = { it->data(), (unsigned) it->size(), mbs_width( *it ) };
+    cells.push_back (cell);
+  }
+  parent.dumpCells (stream, cells);
+
+  if ( !_details.empty() )
+    parent.dumpDetails (stream, _details);
+}
+
+// ----------------------( TableCellPool )-------------------------------------
+
+namespace
+{
+  /** FNV-1a */
+  unsigned hashCell (const char * data, unsigned size)
+  {
+    unsigned h = 2166136261u;
+    for (unsigned i = 0; i < size; ++i)
+      h = (h ^ (unsigned char) data[i]) * 16777619u;
+    return h;
+  }
+}
+
+TableCellPool::TableCellPool()
+  : _slots(16, 0)
+{
+  intern (string());
+}
+
+TableCellPool::Id TableCellPool::intern (const string& s)
+{
+  unsigned hash = hashCell (s.data(), s.size());
+  unsigned mask = _slots.size() - 1;
+  for (unsigned i = hash & mask; ; i = (i + 1) & mask)
+  {
+    Id slot = _slots[i];
+    if (slot == 0)
+      break;
+    const Cell & cell (_cells[slot - 1]);
+    if (cell.hash == hash && cell.size == s.size()
+        && ::memcmp (_text.data() + cell.offset, s.data(), s.size()) == 0)
+      return slot - 1;
+  }
+
+  Cell cell = { (unsigned) _text.size(), (unsigned) s.size(), mbs_width (s), hash };
+  _text.append (s);
+  _cells.push_back (cell);
+  // keep the load under a half
+  if (_cells.size() * 2 > _slots.size())
+    rehash (_slots.size() * 2);
+  else
+    for (unsigned i = hash & mask; ; i = (i + 1) & mask)
+      if (_slots[i] == 0)
+      {
+        _slots[i] = _cells.size();
+        break;
+      }
+  return _cells.size() - 1;
+}
+
+void TableCellPool::rehash (unsigned slots)
+{
+  _slots.assign (slots, 0);
+  unsigned mask = slots - 1;
+  for (unsigned id = 0; id < _cells.size(); ++id)
+    for (unsigned i = _cells[id].hash & mask; ; i = (i + 1) & mask)
+      if (_slots[i] == 0)
+      {
+        _slots[i] = id + 1;
+        break;
+      }
+}
+
+bool TableCellPool::less (Id a, Id b) const
+{
+  if (a == b)
+    return false;
+  unsigned asize = size (a);
+  unsigned bsize = size (b);
+  int cmp = ::memcmp (data (a), data (b), min (asize, bsize));
+  return cmp < 0 || (cmp == 0 && asize < bsize);
+}
+
+// ----------------------( Table )---------------------------------------------
+
+void Table::dumpDetails(ostream &stream, const vector<string> & details) const
 {
-  unsigned int width = (parent._width > parent._screen_width)?parent._screen_width:parent._width;
-  string indent( (parent._max_width[0]+parent._max_width[1])/2, ' ' );
+  unsigned int width = (_width > _screen_width)?_screen_width:_width;
+  string indent( (_max_width[0]+_max_width[1])/2, ' ' );
 
-  for ( vector<string>::const_iterator it = _details.begin(); it != _details.end(); ++it )
+  for ( vector<string>::const_iterator it = details.begin(); it != details.end(); ++it )
   {
     vector<string> text;
     zypp::str::split( *it, std::back_inserter(text), "\n" );
@@ -99,47 +192,43 @@ void TableRow::dumpDetails(ostream &stream, const Table & parent) const
   }
 }
 
-void TableRow::dumpTo (ostream &stream, const Table & parent) const
+void Table::dumpCells (ostream &stream, const vector<CellRef> & cells) const
 {
-  const char * vline = parent._style != none ? lines[parent._style][0] : "";
+  const char * vline = _style != none ? lines[_style][0] : "";
 
-  unsigned int ssize = 0; // string size in columns
   bool seen_first = false;
-  container::const_iterator
-    i = _columns.begin (),
-    e = _columns.end ();
 
   stream.setf (ios::left, ios::adjustfield);
-  stream << string(parent._margin, ' ');
+  stream << string(_margin, ' ');
   // current position at currently printed line
-  int curpos = parent._margin;
+  int curpos = _margin;
   // whether to break the line now in order to wrap it to screen width
   bool do_wrap = false;
   // On a table with 2 edition columns highlight the editions
   // except for the common prefix.
   std::string::size_type editionSep( std::string::npos );
 
-  for (unsigned c = 0; i != e ; ++i, ++c)
+  for (unsigned c = 0; c < cells.size(); ++c)
   {
     if (seen_first)
     {
       do_wrap =
         // user requested wrapping
-        parent._do_wrap &&
+        _do_wrap &&
         // table is wider than screen
-        parent._width > parent._screen_width && (
+        _width > _screen_width && (
         // the next table column would exceed the screen size
-        curpos + (int) parent._max_width[c] + (parent._style != none ? 2 : 3) >
-          parent._screen_width ||
+        curpos + (int) _max_width[c] + (_style != none ? 2 : 3) >
+          _screen_width ||
         // or the user wishes to first break after the previous column
-        parent._force_break_after == (int) (c - 1));
+        _force_break_after == (int) (c - 1));
 
       if (do_wrap)
       {
         // start printing the next table columns to new line,
         // indent by 2 console columns
-        stream << endl << string(parent._margin + 2, ' ');
-        curpos = parent._margin + 2; // indent == 2
+        stream << endl << string(_margin + 2, ' ');
+        curpos = _margin + 2; // indent == 2
       }
       else
         // vertical line, padded with spaces
@@ -150,27 +239,31 @@ void TableRow::dumpTo (ostream &stream, const Table & parent) const
       seen_first = true;
 
     // stream.width (widths[c]); // that does not work with multibyte chars
-    const string & s = *i;
-    ssize = mbs_width (s);
-    if (ssize > parent._max_width[c])
+    const CellRef & cell( cells[c] );
+    // streamed rows are not cut unless the column is to be abbreviated
+    if (cell.width > _max_width[c]
+        && (!_streaming || (c < _abbrev_col.size() && _abbrev_col[c])))
     {
-      unsigned cutby = parent._max_width[c] - 2;
-      string cutstr = mbs_substr_by_width(s, 0, cutby);
+      unsigned cutby = _max_width[c] - 2;
+      string cutstr = mbs_substr_by_width(string(cell.data, cell.size), 0, cutby);
       stream << cutstr << string(cutby - mbs_width(cutstr), ' ') << "->";
     }
     else
     {
-      string s(*i);
-      if ( !parent._inHeader && parent.editionStyle( c ) && Zypper::instance()->config().do_colors )
+      if ( !_inHeader && editionStyle( c ) && Zypper::instance()->config().do_colors )
       {
+	string s( cell.data, cell.size );
 	// Edition column
-	if ( parent._editionStyle.size() == 2 )
+	if ( _editionStyle.size() == 2 )
 	{
 	  // 2 Edition columns - highlight difference
 	  if ( editionSep == std::string::npos )
 	  {
-	    editionSep = zypp::str::commonPrefix( _columns[*parent._editionStyle.begin()],
-						  _columns[*(++parent._editionStyle.begin())] );
+	    unsigned c1 = *_editionStyle.begin();
+	    unsigned c2 = *(++_editionStyle.begin());
+	    editionSep = zypp::str::commonPrefix(
+	      c1 < cells.size() ? string( cells[c1].data, cells[c1].size ) : string(),
+	      c2 < cells.size() ? string( cells[c2].data, cells[c2].size ) : string() );
 	  }
 
 	  if ( editionSep == 0 )
@@ -205,23 +298,16 @@ void TableRow::dumpTo (ostream &stream, const Table & parent) const
       }
       else	// no special style
       {
-	stream << s;
+	stream.write( cell.data, cell.size );
       }
-      stream.width (parent._max_width[c] - ssize);
+      stream.width (cell.width < _max_width[c] ? _max_width[c] - cell.width : 0);
     }
     stream << "";
-    curpos += parent._max_width[c] + (parent._style != none ? 2 : 3);
+    curpos += _max_width[c] + (_style != none ? 2 : 3);
   }
   stream << endl;
-
-  if ( !_details.empty() )
-  {
-    dumpDetails( stream, parent );
-  }
 }
 
-// ----------------------( Table )---------------------------------------------
-
 Table::Table()
   : _has_header (false)
   , _max_col (0)
@@ -232,18 +318,92 @@ Table::Table()
   , _margin(0)
   , _force_break_after(-1)
   , _do_wrap(false)
+  , _stream(NULL)
+  , _stream_sample(0)
+  , _streaming(false)
   , _inHeader( false )
 {}
 
 void Table::add (const TableRow& tr) {
-  _rows.push_back (tr);
-  updateColWidths (tr);
+  if (_row_sink) {
+    _row_sink (tr);
+    return;
+  }
+
+  if (_stream) {
+    // the widths are known now, print what we have
+    if (!_streaming && _order.size() >= _stream_sample) {
+      dumpHeader (*_stream);
+      _streaming = true;
+    }
+    if (_streaming) {
+      dumpRows (*_stream);
+      clearRows ();
+    }
+  }
+
+  unsigned row = _row_cols.size();
+  unsigned cols = tr._columns.size();
+  if (cols > _columns.size())
+    _columns.resize (cols, vector<TableCellPool::Id>(row, 0));
+
+  vector<unsigned> widths (cols);
+  for (unsigned c = 0; c < _columns.size(); ++c) {
+    TableCellPool::Id id = c < cols ? _cells.intern (tr._columns[c]) : 0;
+    _columns[c].push_back (id);
+    if (c < cols)
+      widths[c] = _cells.width (id);
+  }
+  _row_cols.push_back (cols);
+  if (!tr._details.empty())
+    _details[row] = tr._details;
+  _order.push_back (row);
+
+  // the widths of the columns being printed can't change anymore
+  if (!_streaming)
+    updateColWidths (widths);
+}
+
+void Table::stream (ostream& stream, unsigned sample) {
+  _stream = &stream;
+  _stream_sample = sample;
+}
+
+void Table::clearRows () {
+  _cells = TableCellPool();
+  for_( it, _columns.begin(), _columns.end() )
+    it->clear();
+  _row_cols.clear();
+  _details.clear();
+  _order.clear();
+}
+
+void Table::addDetail (const string& s) {
+  if (_row_cols.empty()) {
+    ERR << "no row to add the detail to" << endl;
+    return;
+  }
+  _details[_row_cols.size() - 1].push_back (s);
+}
+
+TableRow Table::row (unsigned i) const {
+  unsigned row = _order[i];
+  TableRow tr (_row_cols[row]);
+  for (unsigned c = 0; c < _row_cols[row]; ++c)
+    tr.add (_cells.str (_columns[c][row]));
+  std::map<unsigned, vector<string> >::const_iterator details = _details.find (row);
+  if (details != _details.end())
+    tr._details = details->second;
+  return tr;
 }
 
 void Table::setHeader (const TableHeader& tr) {
   _has_header = true;
   _header = tr;
-  updateColWidths (tr);
+  vector<unsigned> widths;
+  for_( it, tr._columns.begin(), tr._columns.end() )
+    widths.push_back (mbs_width (*it));
+  updateColWidths (widths);
 }
 
 void Table::allowAbbrev(unsigned column) {
@@ -254,17 +414,14 @@ void Table::allowAbbrev(unsigned column) {
   _abbrev_col[column] = true;
 }
 
-void Table::updateColWidths (const TableRow& tr) {
+void Table::updateColWidths (const vector<unsigned> & widths) {
   // how much columns spearators add to the width of the table
   int sepwidth = _style == none ? 2 : 3;
   // initialize the width to -sepwidth (the first column does not have a line
   // on the left)
   _width = -sepwidth;
 
-  TableRow::container::const_iterator
-    i = tr._columns.begin (),
-    e = tr._columns.end ();
-  for (unsigned c = 0; i != e; ++i, ++c) {
+  for (unsigned c = 0; c < widths.size(); ++c) {
     // ensure that _max_width[c] exists
     if (_max_col < c)
     {
@@ -274,7 +431,7 @@ void Table::updateColWidths (const TableRow& tr) {
     }
 
     unsigned &max = _max_width[c];
-    unsigned cur = mbs_width (*i);
+    unsigned cur = widths[c];
 
     if (max < cur)
       max = cur;
@@ -305,8 +462,7 @@ void Table::dumpRule (ostream &stream) const {
   stream << endl;
 }
 
-void Table::dumpTo (ostream &stream) const {
-
+void Table::dumpHeader (ostream &stream) const {
   // reset column widths for columns that can be abbreviated
   //! \todo allow abbrev of multiple columns?
   unsigned c = 0;
@@ -329,16 +485,36 @@ void Table::dumpTo (ostream &stream) const {
     _header.dumpTo (stream, *this);
     dumpRule (stream);
   }
+}
 
-  container::const_iterator
-    b = _rows.begin (),
-    e = _rows.end (),
-    i;
-  for (i = b; i != e; ++i) {
-    i->dumpTo (stream, *this);
+void Table::dumpRows (ostream &stream) const {
+  vector<CellRef> cells;
+  for_( i, _order.begin(), _order.end() ) {
+    unsigned row = *i;
+    cells.resize (_row_cols[row]);
+    for (unsigned c = 0; c < _row_cols[row]; ++c) {
+      TableCellPool::Id id = _columns[c][row];
+      cells[c].data = _cells.data (id);
+      cells[c].size = _cells.size (id);
+      cells[c].width = _cells.width (id);
+    }
+    dumpCells (stream, cells);
+
+    std::map<unsigned, vector<string> >::const_iterator details = _details.find (row);
+    if (details != _details.end())
+      dumpDetails (stream, details->second);
   }
 }
 
+void Table::dumpTo (ostream &stream) const {
+  ProfileScope profile("render table");
+
+  // the header was printed by add() already
+  if (!_streaming)
+    dumpHeader (stream);
+  dumpRows (stream);
+}
+
 void Table::wrap(int force_break_after)
 {
   if (force_break_after >= 0)
@@ -358,14 +534,55 @@ void Table::margin(unsigned margin) {
     ERR << "margin of " << margin << " is greater than half of the screen" << endl;
 }
 
+namespace
+{
+  /** Orders row indexes by the cells of a column. */
+  struct RowLess
+  {
+    RowLess (const TableCellPool & cells, const vector<TableCellPool::Id> & column)
+      : _cells (cells), _column (column) {}
+
+    bool operator ()(unsigned a, unsigned b) const
+    { return _cells.less (_column[a], _column[b]); }
+
+    const TableCellPool & _cells;
+    const vector<TableCellPool::Id> & _column;
+  };
+}
+
 void Table::sort (unsigned by_column) {
   if (by_column > _max_col) {
     ERR << "by_column >= _max_col (" << by_column << ">=" << _max_col << ")" << endl;
     return;
   }
+  // only the header has the column
+  if (by_column >= _columns.size())
+    return;
+
+  // stable, like the list::sort() of the rows before
+  stable_sort (_order.begin(), _order.end(), RowLess (_cells, _columns[by_column]));
+}
+
+// ----------------------( TableRowHeap )--------------------------------------
+
+void TableRowHeap::add (const TableRow& tr) {
+  if (_limit == 0)
+    return;
+  // a max-heap: the last of the kept rows on top
+  if (_rows.size() < _limit) {
+    _rows.push_back (tr);
+    push_heap (_rows.begin(), _rows.end(), _less);
+  }
+  else if (_less (tr, _rows.front())) {
+    pop_heap (_rows.begin(), _rows.end(), _less);
+    _rows.back() = tr;
+    push_heap (_rows.begin(), _rows.end(), _less);
+  }
+}
 
-  TableRow::Less comp (by_column);
-  _rows.sort (comp);
+void TableRowHeap::addTo (Table & table) const {
+  for_(it, _rows.begin(), _rows.end())
+    table.add (*it);
 }
 
 // Local Variables:
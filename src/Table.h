@@ -14,6 +14,9 @@
 #include <iosfwd>
 #include <list>
 #include <vector>
+#include <map>
+#include <set>
+#include <functional>
 
 #include <zypp/base/String.h>
 
@@ -42,9 +45,6 @@ enum TableLineStyle {
 class Table;
 
 class TableRow {
-private:
-  void dumpDetails(ostream &stream, const Table & parent) const;
-
 public:
   //! Constructor. Reserve place for c columns.
   TableRow (unsigned c = 0) {
@@ -106,17 +106,90 @@ template<class _Tp>
 TableHeader & operator<<( TableHeader & th, const _Tp & val )
 { static_cast<TableRow&>( th ) << val; return th; }
 
-/** \todo nice idea but poor interface */
+/**
+ * The cells of a \ref Table: each distinct string stored once in a common
+ * buffer along with its display width, and referred to by id. Listings of
+ * the whole pool repeat the same repo names, kinds, status flags and
+ * versions over and over, so this saves most of the allocations and
+ * mbs_width() calls.
+ */
+class TableCellPool {
+public:
+  typedef unsigned Id;
+
+  TableCellPool ();
+
+  /** Id of \a s, adding it if it is new. The empty string is id 0. */
+  Id intern (const string& s);
+
+  const char * data (Id id) const
+  { return _text.data() + _cells[id].offset; }
+  unsigned size (Id id) const
+  { return _cells[id].size; }
+  /** Display width, see mbs_width(). */
+  unsigned width (Id id) const
+  { return _cells[id].width; }
+  string str (Id id) const
+  { return string (data (id), size (id)); }
+
+  /** Like std::string's operator<. */
+  bool less (Id a, Id b) const;
+
+private:
+  struct Cell {
+    unsigned offset;
+    unsigned size;
+    unsigned width;
+    unsigned hash;
+  };
+
+  void rehash (unsigned slots);
+
+  string _text;
+  vector<Cell> _cells;
+  //! open addressing hash table of (id + 1), 0 for a free slot
+  vector<Id> _slots;
+};
+
+/**
+ * The rows are kept by column, as ids of the cells in a \ref TableCellPool,
+ * and sorted through a vector of row indexes. Long listings can instead be
+ * printed while they are filled, see \ref stream().
+ * \todo nice idea but poor interface
+ */
 class Table {
 public:
-  typedef list<TableRow> container;
+  /** Receives the added rows instead of the table, see \ref setRowSink(). */
+  typedef std::function<void(const TableRow &)> RowSink;
 
   static TableLineStyle defaultStyle;
 
   void add (const TableRow& tr);
+  /** Add a detail line to the last added row, see TableRow::addDetail(). */
+  void addDetail (const string& s);
+  /** Pass the rows added from now on to \a sink instead of keeping them
+   * (e.g. to print them right away). An empty \a sink ends this. */
+  void setRowSink (const RowSink & sink)
+  { _row_sink = sink; }
   void setHeader (const TableHeader& tr);
   void dumpTo (ostream& stream) const;
-  bool empty () const { return _rows.empty(); }
+  /**
+   * Print the table to \a stream while it is filled, keeping only the rows
+   * not printed yet. The column widths are taken from the header and the
+   * first \a sample rows, which are printed (with the header) once one more
+   * row is added; from then on each row is printed as soon as the next one
+   * comes (it may still get details). Cells of these rows which are wider
+   * than their column are printed whole, shifting the rest of the row.
+   *
+   * The rows must be added in the order to show them. \ref dumpTo() prints
+   * the rest, or the whole table as usual if no more than \a sample rows
+   * were added.
+   */
+  void stream (ostream& stream, unsigned sample = 100);
+  /** Whether no rows were added (including the streamed ones). */
+  bool empty () const { return _order.empty() && !_streaming; }
+  /** Number of rows kept (not printed by \ref stream() yet). */
+  unsigned size () const { return _order.size(); }
   void sort (unsigned by_column);       // columns start with 0...
 
   void lineStyle (TableLineStyle st);
@@ -126,10 +199,8 @@ public:
 
   const TableHeader & header() const
   { return _header; }
-  const container & rows() const
-  { return _rows; }
-  container & rows()
-  { return _rows; }
+  /** A copy of the \a i-th row, in the current order. */
+  TableRow row (unsigned i) const;
 
   Table ();
 
@@ -138,12 +209,41 @@ public:
   { _editionStyle.insert( column ); }
 
 private:
+  /** A cell to be printed. */
+  struct CellRef {
+    const char * data;
+    unsigned size;
+    unsigned width;
+  };
+
   void dumpRule (ostream &stream) const;
-  void updateColWidths (const TableRow& tr);
+  void dumpHeader (ostream &stream) const;
+  void dumpRows (ostream &stream) const;
+  void dumpCells (ostream &stream, const vector<CellRef> & cells) const;
+  void dumpDetails (ostream &stream, const vector<string> & details) const;
+  void updateColWidths (const vector<unsigned> & widths);
+  void clearRows ();
 
   bool _has_header;
   TableHeader _header;
-  container _rows;
+  RowSink _row_sink;
+
+  TableCellPool _cells;
+  //! cell ids by column; shorter rows are padded with empty cells
+  vector<vector<TableCellPool::Id> > _columns;
+  //! number of columns of each row
+  vector<unsigned> _row_cols;
+  //! details of the rows having any, by row index
+  std::map<unsigned, vector<string> > _details;
+  //! row indexes in the order to show them
+  vector<unsigned> _order;
+
+  //! where to print the rows while filling the table, see stream()
+  ostream * _stream;
+  //! number of rows to take the column widths from before streaming
+  unsigned _stream_sample;
+  //! whether the header and first rows have been printed to _stream
+  bool _streaming;
 
   //! maximum column index seen in this table
   unsigned _max_col;
@@ -173,6 +273,27 @@ private:
   friend class TableRow;
 };
 
+/**
+ * Keeps the first \a limit rows by column \a by_column of those added, in a
+ * bounded heap. Meant as the \ref Table::RowSink of a table which should
+ * show only the top rows, without keeping all of them meanwhile.
+ */
+class TableRowHeap {
+public:
+  TableRowHeap (unsigned limit, unsigned by_column)
+    : _limit (limit), _less (by_column) {}
+
+  void add (const TableRow& tr);
+
+  /** Add the kept rows to \a table, in no particular order. */
+  void addTo (Table & table) const;
+
+private:
+  unsigned _limit;
+  TableRow::Less _less;
+  vector<TableRow> _rows;
+};
+
 namespace table
 {
   /** TableHeader manipulator */
@@ -12,9 +12,11 @@
 #include <fstream>
 #include <sstream>
 #include <streambuf>
+#include <cstdio>
 #include <list>
 #include <map>
 #include <iterator>
+#include <algorithm>
 
 #include <unistd.h>
 #include <readline/history.h>
@@ -29,6 +31,7 @@
 #include <zypp/base/Algorithm.h>
 #include <zypp/base/UserRequestException.h>
 #include <zypp/base/DtorReset.h>
+#include <zypp/base/Xml.h>
 
 #include <zypp/sat/SolvAttr.h>
 #include <zypp/AutoDispose.h>
@@ -47,11 +50,19 @@
 #include "utils/misc.h"
 #include "utils/messages.h"
 #include "utils/getopt.h"
+#include "utils/text.h"
+#include "utils/Profiler.h"
 #include "utils/misc.h"
 
 #include "repos.h"
 #include "update.h"
 #include "solve-commit.h"
+#include "PoolSnapshot.h"
+#include "SearchIndex.h"
+#include "ParallelSearch.h"
+#include "Suggestions.h"
+#include "QueryCache.h"
+#include "Daemon.h"
 #include "misc.h"
 #include "locks.h"
 #include "search.h"
@@ -73,7 +84,8 @@ Zypper::Zypper()
   : _argc(0), _argv(NULL), _out_ptr(NULL),
     _command(ZypperCommand::NONE),
     _exit_code(ZYPPER_EXIT_OK),
-    _running_shell(false), _running_help(false), _exit_requested(false),
+    _running_shell(false), _running_help(false), _running_daemon(false),
+    _exit_requested(false),
     _sh_argc(0), _sh_argv(NULL)
 {
   MIL << "Zypper instance created." << endl;
@@ -107,6 +119,7 @@ int Zypper::main(int argc, char ** argv)
 
   // parse global options and the command
   try {
+    ProfileScope profile("processGlobalOptions");
     processGlobalOptions();
   }
   catch (const ExitRequestException & e)
@@ -128,10 +141,17 @@ int Zypper::main(int argc, char ** argv)
     cleanup();
     return exitCode();
 
+  case ZypperCommand::BATCH_e:
+    commandBatch();
+    cleanup();
+    return exitCode();
+
   case ZypperCommand::NONE_e:
     return ZYPPER_EXIT_ERR_SYNTAX;
 
   default:
+    if (daemon_forward(*this))
+      return exitCode();
     safeDoCommand();
     cleanup();
     return exitCode();
@@ -142,6 +162,37 @@ int Zypper::main(int argc, char ** argv)
   return exitCode();
 }
 
+int Zypper::daemonCommand(int argc, char ** argv)
+{
+  _argc = argc;
+  _argv = argv;
+  _gopts = GlobalOptions();
+  _rdata.additional_repos.clear();
+  _exit_code = ZYPPER_EXIT_OK;
+  _running_daemon = true;
+  // reset getopt
+  optind = 0;
+
+  try {
+    processGlobalOptions();
+  }
+  catch (const ExitRequestException & e)
+  {
+    MIL << "Caught exit request:" << endl << e.msg() << endl;
+    return exitCode();
+  }
+
+  // the client's stdin is not available to us
+  _gopts.non_interactive = true;
+  _gopts.no_refresh = true;
+
+  if (command() == ZypperCommand::NONE && !runningHelp())
+    return exitCode() ? exitCode() : ZYPPER_EXIT_ERR_SYNTAX;
+
+  safeDoCommand();
+  return exitCode();
+}
+
 Out & Zypper::out()
 {
   if (_out_ptr)
@@ -173,6 +224,8 @@ void print_main_help(Zypper & zypper)
     "\t\t\t\tthe rebootSuggested-flag set.\n"
     "\t--xmlout, -x\t\tSwitch to XML output.\n"
     "\t--ignore-unknown, -i\tIgnore unknown packages.\n"
+    "\t--profile[=<file>]\tWrite the time spent in the individual phases\n"
+    "\t\t\t\tas a trace (zypper-profile.json by default).\n"
   );
 
   static string repo_manager_options = _(
@@ -205,6 +258,7 @@ void print_main_help(Zypper & zypper)
     "  Commands:\n"
     "\thelp, ?\t\t\tPrint help.\n"
     "\tshell, sh\t\tAccept multiple commands at once.\n"
+    "\tbatch\t\t\tRun the commands from a file, one per line.\n"
   );
 
   static string help_repo_commands = _("     Repository Management:\n"
@@ -399,6 +453,7 @@ void Zypper::processGlobalOptions()
     {"config",                     required_argument, 0, 'c'},
     {"userdata",                   required_argument, 0,  0 },
     {"ignore-unknown",             no_argument,       0, 'i'},
+    {"profile",                    optional_argument, 0,  0 },
     {0, 0, 0, 0}
   };
 
@@ -412,6 +467,10 @@ void Zypper::processGlobalOptions()
 
   parsed_opts::const_iterator it;
 
+  if ((it = gopts.find("profile")) != gopts.end())
+    Profiler::instance().enable(
+        it->second.front().empty() ? "zypper-profile.json" : it->second.front());
+
   // read config from specified file or default config files
   _config.read(
       (it = gopts.find("config")) != gopts.end() ? it->second.front() : "");
@@ -731,6 +790,27 @@ void Zypper::processGlobalOptions()
       }
     }
   }
+  else if (command() == ZypperCommand::BATCH)
+  {
+    string arg = optind < _argc ? _argv[optind++] : "";
+    if (arg == "-h" || arg == "--help")
+      setRunningHelp(true);
+    else if (arg.empty())
+    {
+      out().error(_("Missing the file with the commands to run."));
+      print_command_help_hint(*this);
+      setExitCode(ZYPPER_EXIT_ERR_INVALID_ARGS);
+      ZYPP_THROW(ExitRequestException("no batch file"));
+    }
+    else if (optind < _argc)
+    {
+      report_too_many_arguments("batch <file|->\n");
+      setExitCode(ZYPPER_EXIT_ERR_INVALID_ARGS);
+      ZYPP_THROW(ExitRequestException("too many arguments"));
+    }
+    else
+      _batch_file = arg;
+  }
 
   // additional repositories
   if (gopts.count("plus-repo"))
@@ -841,8 +921,8 @@ void Zypper::commandShell()
 
     try
     {
-      MIL << "Reloading..." << endl;
-      God->target()->reload();   // reload system in case rpm database has changed
+      // reload the installed packages in case the rpm database has changed
+      reload_target_resolvables(*this);
       setCommand(ZypperCommand(command_str));
       if (command() == ZypperCommand::SHELL_QUIT)
         break;
@@ -867,6 +947,189 @@ void Zypper::commandShell()
   setRunningShell(false);
 }
 
+namespace
+{
+  /**
+   * Redirects the stdout and stderr file descriptors into a temporary file
+   * for its lifetime and leaves what was written there in \a buf.
+   *
+   * Swapping the cout/cerr buffers is not enough: rpm scriptlets, the pager
+   * and other child processes write to the descriptors directly.
+   */
+  struct CaptureOutput
+  {
+    CaptureOutput(string & buf)
+      : _buf(buf)
+      , _file(NULL)
+      , _stdout(-1)
+      , _stderr(-1)
+    {
+      flushAll();
+      _file = ::tmpfile();
+      if (!_file)
+      {
+        WAR << "Cannot create a temporary file, output not captured." << endl;
+        return;
+      }
+      _stdout = ::dup(STDOUT_FILENO);
+      _stderr = ::dup(STDERR_FILENO);
+      ::dup2(::fileno(_file), STDOUT_FILENO);
+      ::dup2(::fileno(_file), STDERR_FILENO);
+    }
+
+    ~CaptureOutput()
+    {
+      if (!_file)
+        return;
+      flushAll();
+      ::dup2(_stdout, STDOUT_FILENO);
+      ::dup2(_stderr, STDERR_FILENO);
+      ::close(_stdout);
+      ::close(_stderr);
+
+      ::rewind(_file);
+      char chunk[4096];
+      size_t n;
+      while ((n = ::fread(chunk, 1, sizeof(chunk), _file)) > 0)
+        _buf.append(chunk, n);
+      ::fclose(_file);
+    }
+
+    static void flushAll()
+    {
+      cout << flush;
+      cerr << flush;
+      ::fflush(NULL);
+    }
+
+    string & _buf;
+    FILE * _file;
+    int _stdout;
+    int _stderr;
+  };
+} // namespace
+
+void Zypper::commandBatch()
+{
+  MIL << "Running the commands from " << _batch_file << endl;
+
+  ifstream file;
+  if (_batch_file != "-")
+  {
+    file.open(_batch_file.c_str());
+    if (!file)
+    {
+      out().error(boost::str(format(_("Cannot read the file '%s'.")) % _batch_file));
+      setExitCode(ZYPPER_EXIT_ERR_INVALID_ARGS);
+      return;
+    }
+  }
+  istream & in(_batch_file == "-" ? cin : file);
+
+  setRunningShell(true);
+  // nobody to answer the prompts, and stdin may be the command list itself
+  _gopts.non_interactive = true;
+  _gopts.machine_readable = true;
+  // escape sequences would end up in the captured records
+  bool do_colors = _config.do_colors;
+  _config.do_colors = false;
+  OutNormal * out_normal = dynamic_cast<OutNormal *>(_out_ptr);
+  if (out_normal)
+    out_normal->setUseColors(false);
+
+  if ( _gopts.changedRoot && _gopts.root_dir != "/" )
+  {
+    // bnc#575096: Quick fix
+    ::setenv( "ZYPP_LOCKFILE_ROOT", _gopts.root_dir.c_str(), 0 );
+  }
+
+  God = zypp::getZYpp();
+
+  int batch_exit_code = ZYPPER_EXIT_OK;
+  unsigned lineno = 0;
+  string line;
+  while (!exitRequested() && getline(in, line))
+  {
+    ++lineno;
+    line = str::trim(line);
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    DBG << "Got: " << line << endl;
+    // reset optind etc
+    optind = 0;
+    // split it up and create sh_argc, sh_argv
+    Args args(line);
+    _sh_argc = args.argc();
+    _sh_argv = args.argv();
+
+    string command_str = _sh_argv[0] ? _sh_argv[0] : "";
+
+    string captured;
+    {
+      CaptureOutput capture(captured);
+      try
+      {
+        // the target is initialized in the capture of the first command, so
+        // that its messages end up in that command's record
+        init_target(*this);
+        // reload the installed packages in case the rpm database has changed
+        reload_target_resolvables(*this);
+        setCommand(ZypperCommand(command_str));
+        if (command() == ZypperCommand::SHELL
+            || command() == ZypperCommand::BATCH
+            || command() == ZypperCommand::SHELL_QUIT)
+        {
+          out().error(boost::str(format(
+            _("Command '%s' can't be used in a batch.")) % command_str));
+          setExitCode(ZYPPER_EXIT_ERR_INVALID_ARGS);
+        }
+        else
+          safeDoCommand();
+      }
+      catch (const ExitRequestException & e)
+      {
+        // target initialization failed, the error is already reported
+        MIL << "Batch stopped: " << e.msg() << endl;
+        requestExit();
+      }
+      catch (const Exception & e)
+      {
+        out().error(e.msg());
+        print_unknown_command_hint(*this);
+        setExitCode(ZYPPER_EXIT_ERR_SYNTAX);
+      }
+    }
+
+    int command_exit_code = exitCode();
+    if (command_exit_code != ZYPPER_EXIT_OK && batch_exit_code == ZYPPER_EXIT_OK)
+      batch_exit_code = command_exit_code;
+
+    // one record per command
+    if (out().type() == Out::TYPE_XML)
+      cout << "<batch-result line=\"" << lineno << "\""
+           << " command=\"" << xml::escape(line) << "\""
+           << " exit-code=\"" << command_exit_code << "\">" << endl
+           << captured
+           << "</batch-result>" << endl;
+    else
+      cout << "{\"line\": " << lineno
+           << ", \"command\": " << json_string(line)
+           << ", \"exit_code\": " << command_exit_code
+           << ", \"output\": " << json_string(captured)
+           << "}" << endl;
+
+    shellCleanup();
+  }
+
+  MIL << "Done with the commands from " << _batch_file << endl;
+  _config.do_colors = do_colors;
+  if (out_normal)
+    out_normal->setUseColors(do_colors);
+  setRunningShell(false);
+  setExitCode(batch_exit_code);
+}
+
 void Zypper::shellCleanup()
 {
   MIL << "Cleaning up for the next command." << endl;
@@ -881,6 +1144,32 @@ void Zypper::shellCleanup()
     remove_selections(*this);
     break;
   }
+  case ZypperCommand::ADD_REPO_e:
+  case ZypperCommand::REMOVE_REPO_e:
+  case ZypperCommand::RENAME_REPO_e:
+  case ZypperCommand::MODIFY_REPO_e:
+  case ZypperCommand::REFRESH_e:
+  case ZypperCommand::CLEAN_e:
+  case ZypperCommand::ADD_SERVICE_e:
+  case ZypperCommand::REMOVE_SERVICE_e:
+  case ZypperCommand::MODIFY_SERVICE_e:
+  case ZypperCommand::REFRESH_SERVICES_e:
+  {
+    // read the repos and their resolvables again in the next command,
+    // the pool is kept otherwise
+    reset_repos(*this);
+    // cause the RepoManager to be reinitialized
+    _rm.reset();
+    break;
+  }
+  case ZypperCommand::ADD_LOCK_e:
+  case ZypperCommand::REMOVE_LOCK_e:
+  case ZypperCommand::CLEAN_LOCKS_e:
+  {
+    // the lock file has changed, the kept pool still has the old locks
+    reload_locks(*this);
+    break;
+  }
   default:;
   }
 
@@ -900,15 +1189,6 @@ void Zypper::shellCleanup()
 
   // runtime data
   _rdata.current_repo = RepoInfo();
-
-  // cause the RepoManager to be reinitialized
-  _rm.reset();
-
-  // TODO:
-  // _rdata.repos re-read after repo operations or modify/remove these very repoinfos
-  // _rdata.repo_resolvables re-read only after certain repo operations (all?)
-  // _rdata.target_resolvables re-read only after installation/removal/update
-  // call target commit refresh pool after installation/removal/update (#328855)
 }
 
 
@@ -922,6 +1202,14 @@ void Zypper::safeDoCommand()
     if (command() == ZypperCommand::NONE || exitCode())
       return;
 
+    // leave commands which need a differently loaded pool to the client
+    if (runningDaemon() && !runningHelp() && !daemon_can_serve(*this))
+    {
+      MIL << "zypperd can't run this command" << endl;
+      setExitCode(ZYPPERD_EXIT_REFUSED);
+      return;
+    }
+
     // "what-provides" is obsolete, functionality is provided by "search"
     if (command() == ZypperCommand::WHAT_PROVIDES_e)
     {
@@ -1615,6 +1903,10 @@ void Zypper::processCommandOptions()
       {"download-only", no_argument, 0, 'D'},
       {"repo", required_argument, 0, 'r'},
       {"services", no_argument, 0, 's'},
+      {"parallel", required_argument, 0, 0},
+      {"stats", no_argument, 0, 0},
+      {"stats-file", required_argument, 0, 0},
+      {"deadline", required_argument, 0, 0},
       {"help", no_argument, 0, 'h'},
       {0, 0, 0, 0}
     };
@@ -1633,6 +1925,12 @@ void Zypper::processCommandOptions()
       "-D, --download-only      Only download raw metadata, don't build the database.\n"
       "-r, --repo <alias|#|URI> Refresh only specified repositories.\n"
       "-s, --services           Refresh also services before refreshing repos.\n"
+      "    --parallel <N>       Download up to N repositories at once while building\n"
+      "                         caches of the already downloaded ones.\n"
+      "    --stats              Show time spent in the individual refresh phases.\n"
+      "    --stats-file <FILE>  Write the refresh statistics to FILE in JSON format.\n"
+      "    --deadline <SEC>     Refresh the most important repositories that fit\n"
+      "                         in SEC seconds, leave the rest as they are.\n"
     );
     break;
   }
@@ -1949,6 +2247,9 @@ void Zypper::processCommandOptions()
       {"repo", required_argument, 0, 'r'},
       {"details", no_argument, 0, 's'},
       {"verbose", no_argument, 0, 'v'},
+      {"no-status", no_argument, 0, 0},
+      {"parallel", required_argument, 0, 0},
+      {"limit", required_argument, 0, 0},
       {"help", no_argument, 0, 'h'},
       {0, 0, 0, 0}
     };
@@ -1983,6 +2284,12 @@ void Zypper::processCommandOptions()
       "                           on a separate line.\n"
       "-v, --verbose              Like --details, with additional information where the\n"
       "                           search has matched (useful for search in dependencies).\n"
+      "    --no-status            Don't show the installation status (faster, useful\n"
+      "                           in scripts).\n"
+      "    --parallel <N>         Evaluate the query in up to N processes, each\n"
+      "                           searching a share of the repositories (default:\n"
+      "                           one per CPU for big pools).\n"
+      "    --limit <N>            Show only the first N results in the sort order.\n"
       "\n"
       "* and ? wildcards can also be used within search strings.\n"
       "If a search string is enclosed in '/', it's interpreted as a regular expression.\n"
@@ -2534,6 +2841,26 @@ void Zypper::processCommandOptions()
     break;
   }
 
+  case ZypperCommand::BATCH_e:
+  {
+    static struct option batch_options[] = {
+      {"help", no_argument, 0, 'h'},
+      {0, 0, 0, 0}
+    };
+    specific_options = batch_options;
+    _command_help = _(
+      "batch <file|->\n"
+      "\n"
+      "Run the commands from the file (or standard input), one per line,\n"
+      "non-interactively and on the once loaded packages. For each command,\n"
+      "a record with the command, its exit code and its output is printed:\n"
+      "a JSON object per line, or a <batch-result> element with --xmlout.\n"
+      "\n"
+      "This command has no additional options.\n"
+    );
+    break;
+  }
+
   case ZypperCommand::RUG_SERVICE_TYPES_e:
   {
     static struct option options[] = {
@@ -2687,6 +3014,8 @@ void Zypper::doCommand()
 {
   if (runningHelp()) { out().info(_command_help, Out::QUIET); return; }
 
+  ProfileScope profile("command", command().asString());
+
   // === ZYpp lock ===
   switch ( command().toEnum() )
   {
@@ -3838,6 +4167,46 @@ void Zypper::doCommand()
       inst_notinst = true;
     //  query.setInstalledOnly();
 
+    bool show_status = !copts.count("no-status");
+    if (!show_status && (copts.count("installed-only") || copts.count("uninstalled-only")))
+    {
+      out().error(boost::str(format(
+        _("The option %s can't be combined with %s or %s."))
+        % "--no-status" % "--installed-only" % "--uninstalled-only"));
+      setExitCode(ZYPPER_EXIT_ERR_INVALID_ARGS);
+      return;
+    }
+
+    // show only the first N results
+    unsigned limit = 0;
+    if (copts.count("limit"))
+    {
+      str::strtonum(copts["limit"].front(), limit);
+      if (limit == 0)
+      {
+        out().error(boost::str(format(
+            _("Invalid number of results '%s'.")) % copts["limit"].front()),
+            _("Specify a positive integer number."));
+        setExitCode(ZYPPER_EXIT_ERR_INVALID_ARGS);
+        return;
+      }
+    }
+
+    // number of worker processes for --parallel, 0 for automatic
+    unsigned jobs = 0;
+    if (copts.count("parallel"))
+    {
+      str::strtonum(copts["parallel"].front(), jobs);
+      if (jobs == 0)
+      {
+        out().error(boost::str(format(
+            _("Invalid number of parallel jobs '%s'.")) % copts["parallel"].front()),
+            _("Specify a positive integer number."));
+        setExitCode(ZYPPER_EXIT_ERR_INVALID_ARGS);
+        return;
+      }
+    }
+
     if (copts.count("match-exact"))
     {
       query.setMatchExact();
@@ -3901,6 +4270,13 @@ void Zypper::doCommand()
     }
 
     bool details = false;
+    // the strings searched in names, summaries and descriptions, and file
+    // lists are looked up in the search indexes if possible (see below),
+    // the rest is added to the query right away
+    vector<string> name_terms;
+    vector<string> desc_terms;
+    vector<string> path_terms;
+    bool query_attrs = false;
     // add argument strings and attributes to query
     for ( vector<string>::const_iterator it = _arguments.begin();
           it != _arguments.end(); ++it )
@@ -3925,16 +4301,26 @@ void Zypper::doCommand()
 
       zypp::sat::SolvAttr attr = sat::SolvAttr::name;
 
+      // plain strings, no edition or architecture
+      bool indexable = !cap.detail().isVersioned() && !cap.detail().hasArch();
+      if ( !indexable || copts.count("requires") || copts.count("recommends")
+           || copts.count("suggests") || copts.count("conflicts") || copts.count("obsoletes") )
+        query_attrs = true;
+
       if (copts.count("provides"))
       {
         attr =  zypp::sat::SolvAttr::provides;
         query.addDependency( attr , name, cap.detail().op(), cap.detail().ed(), Arch(cap.detail().arch()) );
+        query_attrs = true;
         if ( str::regex_match(name.c_str(), string("^/")) )
         {
           // in case of path names also search in file list
           attr = zypp::sat::SolvAttr::filelist;
           query.setFilesMatchFullPath(true);
-          query.addDependency( attr , name, cap.detail().op(), cap.detail().ed(), Arch(cap.detail().arch()) );
+          if ( indexable )
+            path_terms.push_back( name );
+          else
+            query.addDependency( attr , name, cap.detail().op(), cap.detail().ed(), Arch(cap.detail().arch()) );
         }
       }
       if (copts.count("requires"))
@@ -3966,12 +4352,18 @@ void Zypper::doCommand()
       {
         attr = zypp::sat::SolvAttr::filelist;
 	query.setFilesMatchFullPath( true );
-        query.addDependency( attr , name, cap.detail().op(), cap.detail().ed(), Arch(cap.detail().arch()) );
+        if ( indexable )
+          path_terms.push_back( name );
+        else
+          query.addDependency( attr , name, cap.detail().op(), cap.detail().ed(), Arch(cap.detail().arch()) );
       }
       if ( attr == sat::SolvAttr::name || copts.count("name") )
       {
         // addDependency can also be used for sat::SolvAttr::name
-        query.addDependency( sat::SolvAttr::name, name, cap.detail().op(), cap.detail().ed(), Arch(cap.detail().arch()) );
+        if ( indexable )
+          name_terms.push_back( name );
+        else
+          query.addDependency( sat::SolvAttr::name, name, cap.detail().op(), cap.detail().ed(), Arch(cap.detail().arch()) );
       }
       if ( attr != sat::SolvAttr::name && cap.detail().isVersioned() )
       {
@@ -3979,26 +4371,184 @@ void Zypper::doCommand()
         // all strings without an edition match to all editions
         query.setMatchExact();
       }
-      // for search in summary and description use addAttribute
       if ( cOpts().count("search-descriptions") )
-      {
-        query.addAttribute(sat::SolvAttr::summary, name );
-        query.addAttribute(sat::SolvAttr::description, name );
-      }
+        desc_terms.push_back( name );
     }
 
+    QueryCache cache(*this);
+    if (cache.replay())
+      return;
+
     init_target(*this);
 
     // now load resolvables:
     load_resolvables(*this);
-    // needed to compute status of PPP
-    resolve(*this);
+    cache.record();
+
+    // the status of PPP needs the solver, but only patches are shown
+    // with it; the search callbacks run the solver on the first patch
+    if (command() == ZypperCommand::RUG_PATCH_SEARCH)
+      resolve_status(*this);
+
+    // the column the result is sorted by (and --limit selects by),
+    // including the status column
+    unsigned nostatus = show_status ? 0 : 1;
+    bool by_repo = copts.count("sort-by-catalog") || copts.count("sort-by-repo");
+    unsigned sort_column = 1 - nostatus; // sort by name
+    if (command() == ZypperCommand::RUG_PATCH_SEARCH)
+      sort_column = by_repo ? 1 : 3;
+    else if (_gopts.is_rug_compatible)
+      sort_column = by_repo ? 1 - nostatus : 3 - nostatus;
+    else if (_copts.count("details"))
+      sort_column = by_repo ? 5 - nostatus : 1 - nostatus;
+    // (can't sort by repo otherwise)
 
     Table t;
     t.lineStyle(Ascii);
 
     try
     {
+      // The query matches if any of its attributes matches, so the names,
+      // summaries and descriptions, and file lists can each be searched
+      // by the indexes of the repos where possible, and by queries limited
+      // to the repos without indexes otherwise.
+      std::set<sat::Solvable> matches;
+      bool use_index = false;
+      bool indexes = command() != ZypperCommand::RUG_PATCH_SEARCH && !_copts.count("verbose");
+      // The plain verbose search takes its rows from the query iterator, as
+      // it shows where each one matched. With details (-s, --rug or a
+      // versioned term) -v only disables the indexes, the rows come from the
+      // matches as usual.
+      bool verbose_rows = !_gopts.is_rug_compatible && !_copts.count("details") && !details
+        && _copts.count("verbose");
+      std::set<string> unindexed;
+
+      if ( !name_terms.empty() )
+      {
+        if ( indexes && search_names( *this, query, name_terms, matches, unindexed ) )
+        {
+          use_index = true;
+          if ( !unindexed.empty() )
+          {
+            zypp::PoolQuery name_query( search_query( query, unindexed ) );
+            for_( it, name_terms.begin(), name_terms.end() )
+              name_query.addDependency( sat::SolvAttr::name, *it );
+            search_solvables( name_query, matches, jobs );
+          }
+        }
+        else
+        {
+          for_( it, name_terms.begin(), name_terms.end() )
+            query.addDependency( sat::SolvAttr::name, *it );
+          query_attrs = true;
+        }
+      }
+
+      unindexed.clear();
+      if ( !desc_terms.empty() )
+      {
+        if ( indexes && search_descriptions( *this, query, desc_terms, matches, unindexed ) )
+        {
+          use_index = true;
+          if ( !unindexed.empty() )
+          {
+            zypp::PoolQuery desc_query( search_query( query, unindexed ) );
+            for_( it, desc_terms.begin(), desc_terms.end() )
+            {
+              desc_query.addAttribute( sat::SolvAttr::summary, *it );
+              desc_query.addAttribute( sat::SolvAttr::description, *it );
+            }
+            search_solvables( desc_query, matches, jobs );
+          }
+        }
+        else
+        {
+          for_( it, desc_terms.begin(), desc_terms.end() )
+          {
+            query.addAttribute( sat::SolvAttr::summary, *it );
+            query.addAttribute( sat::SolvAttr::description, *it );
+          }
+          query_attrs = true;
+        }
+      }
+
+      unindexed.clear();
+      if ( !path_terms.empty() )
+      {
+        if ( indexes && search_paths( *this, query, path_terms, matches, unindexed ) )
+        {
+          use_index = true;
+          if ( !unindexed.empty() )
+          {
+            zypp::PoolQuery path_query( search_query( query, unindexed ) );
+            for_( it, path_terms.begin(), path_terms.end() )
+              path_query.addDependency( sat::SolvAttr::filelist, *it );
+            search_solvables( path_query, matches, jobs );
+          }
+        }
+        else
+        {
+          for_( it, path_terms.begin(), path_terms.end() )
+            query.addDependency( sat::SolvAttr::filelist, *it );
+          query_attrs = true;
+        }
+      }
+
+      // the rest (or all of it without the indexes), also collected in
+      // matches (except for the plain verbose and rug patch search) so that
+      // the query can be evaluated by parallel workers
+      if ( command() != ZypperCommand::RUG_PATCH_SEARCH && !verbose_rows
+           && ( query_attrs || !use_index ) )
+        search_solvables( query, matches, jobs );
+
+      // With --limit only the first rows by the sort column are kept.
+      // Otherwise machine readable output is printed as the rows are found,
+      // with the status of patches established beforehand so that no solver
+      // messages get in between.
+      TableRowHeap top( limit, sort_column );
+      bool streaming = !limit && out().streamsSearchResult();
+      unsigned streamed = 0;
+      // Otherwise, if the output goes to another program and the rows are
+      // sorted by name, they are added in that order and the table is
+      // printed while it is filled (with the status established first too).
+      bool stream_table = !limit && !streaming && !::isatty(STDOUT_FILENO)
+        && command() != ZypperCommand::RUG_PATCH_SEARCH && !_gopts.is_rug_compatible
+        && !verbose_rows && sort_column == 1 - nostatus;
+
+      // Only patches need the solver for their status. The rows of the
+      // verbose search come from the query, not from the matches.
+      bool patch_status = ( streaming || stream_table ) && show_status
+        && command() != ZypperCommand::RUG_PATCH_SEARCH
+        && ( query.kinds().empty() || query.kinds().count( ResKind::patch ) );
+      if ( patch_status && !verbose_rows )
+      {
+        patch_status = false;
+        for_( it, matches.begin(), matches.end() )
+          if ( it->isKind( ResKind::patch ) )
+          {
+            patch_status = true;
+            break;
+          }
+      }
+      if ( patch_status )
+        resolve_status(*this);
+
+      if ( limit )
+        t.setRowSink( [&top]( const TableRow & row ) { top.add( row ); } );
+      else if ( streaming )
+      {
+        t.setRowSink( [this, &t, &streamed]( const TableRow & row ) {
+          out().searchResultRow( t.header(), row );
+          ++streamed;
+        } );
+      }
+      else if ( stream_table )
+      {
+        if ( !matches.empty() )
+          cout << endl;
+        t.stream( cout );
+      }
+
       if (command() == ZypperCommand::RUG_PATCH_SEARCH)
       {
         FillPatchesTable callback(t, inst_notinst);
@@ -4007,11 +4557,16 @@ void Zypper::doCommand()
       else if (_gopts.is_rug_compatible || _copts.count("details") || details)
       {
         FillSearchTableSolvable callback(t, inst_notinst);
-        invokeOnEach(query.selectableBegin(), query.selectableEnd(), callback);
+        callback._establish_status = true;
+        std::vector<ui::Selectable::constPtr> sels( search_selectables(matches) );
+        if ( stream_table )
+          std::stable_sort( sels.begin(), sels.end(), SelectableNameLess() );
+        invokeOnEach(sels.begin(), sels.end(), callback);
       }
       else if ( _copts.count("verbose") )
       {
         FillSearchTableSolvable callback(t, inst_notinst);
+        callback._establish_status = true;
         // Option 'verbose' shows where (e.g. in 'requires', 'name') the search has matched.
         // Info is available from PoolQuery::const_iterator.
         for_( it, query.begin(), query.end() )
@@ -4022,46 +4577,41 @@ void Zypper::doCommand()
       else
       {
         FillSearchTableSelectable callback(t, inst_notinst);
-        invokeOnEach(query.selectableBegin(), query.selectableEnd(), callback);
+        callback._establish_status = true;
+        std::vector<ui::Selectable::constPtr> sels( search_selectables(matches) );
+        if ( stream_table )
+          std::stable_sort( sels.begin(), sels.end(), SelectableNameLess() );
+        invokeOnEach(sels.begin(), sels.end(), callback);
       }
 
-      if (t.empty())
+      t.setRowSink( Table::RowSink() );
+      if ( limit )
+        top.addTo( t );
+      else if ( streaming && streamed )
+        out().searchResultEnd();
+
+      if ( streaming ? !streamed : t.empty() )
       {
         out().info(_("No packages found."), Out::QUIET);
+        if ( !query.matchGlob() && !query.matchRegex() )
+        {
+          ResKind suggest_kind;
+          if ( query.kinds().size() == 1 )
+            suggest_kind = *query.kinds().begin();
+          for_( it, name_terms.begin(), name_terms.end() )
+            print_similar_names( *this, *it, suggest_kind );
+        }
         setExitCode(ZYPPER_EXIT_INF_CAP_NOT_FOUND);
       }
-      else
+      else if ( !streaming )
       {
-        cout << endl; //! \todo  out().separator()?
+        if ( !stream_table )
+          cout << endl; //! \todo  out().separator()?
 
-        if (command() == ZypperCommand::RUG_PATCH_SEARCH)
-        {
-          if (copts.count("sort-by-catalog") || copts.count("sort-by-repo"))
-            t.sort(1);
-          else
-            t.sort(3); // sort by name
-        }
-        else if (_gopts.is_rug_compatible)
-        {
-          if (copts.count("sort-by-catalog") || copts.count("sort-by-repo"))
-            t.sort(1);
-          else
-            t.sort(3); // sort by name
-        }
-        else if (_copts.count("details"))
-        {
-          if (copts.count("sort-by-catalog") || copts.count("sort-by-repo"))
-            t.sort(5);
-          else
-            t.sort(1); // sort by name
-        }
-        else
-        {
-          // sort by name (can't sort by repo)
-          t.sort(1);
-          if (!globalOpts().no_abbrev)
-            t.allowAbbrev(2);
-        }
+        t.sort(sort_column);
+        if (command() != ZypperCommand::RUG_PATCH_SEARCH && !_gopts.is_rug_compatible
+            && !_copts.count("details") && !globalOpts().no_abbrev)
+          t.allowAbbrev(2 - nostatus);
 
 	//cout << t; //! \todo out().table()?
 	out().searchResult( t );
@@ -4106,7 +4656,7 @@ void Zypper::doCommand()
     // now load resolvables:
     load_resolvables(*this);
     // needed to compute status of PPP
-    resolve(*this);
+    resolve_status(*this);
 
     patch_check();
 
@@ -4146,7 +4696,7 @@ void Zypper::doCommand()
     AutoDispose<bool> restoreCleandepsOnRemove( God->resolver()->cleandepsOnRemove(),
 						bind( &Resolver::setCleandepsOnRemove, God->resolver(), _1 ) );
     God->resolver()->setCleandepsOnRemove( true );
-    resolve(*this);
+    resolve_status(*this);
 
     switch (command().toEnum())
     {
@@ -4191,11 +4741,17 @@ void Zypper::doCommand()
 
     initRepoManager();
 
-    init_target(*this);
     init_repos(*this);
     if (exitCode() != ZYPPER_EXIT_OK)
       return;
+
+    QueryCache cache(*this);
+    if (cache.replay())
+      return;
+
+    init_target(*this);
     load_resolvables(*this);
+    cache.record();
 
     switch (command().toEnum())
     {
@@ -4273,7 +4829,7 @@ void Zypper::doCommand()
     if (exitCode() != ZYPPER_EXIT_OK)
       return;
     load_resolvables(*this);
-    resolve(*this);
+    resolve_status(*this);
 
     if (copts.count("bugzilla") || copts.count("bz")
         || copts.count("cve") || copts.count("issues"))
@@ -4594,13 +5150,19 @@ void Zypper::doCommand()
     }
 
     initRepoManager();
-    init_target(*this);
     init_repos(*this);
     if (exitCode() != ZYPPER_EXIT_OK)
       return;
+
+    QueryCache cache(*this);
+    if (cache.replay())
+      return;
+
+    init_target(*this);
     load_resolvables(*this);
     // needed to compute status of PPP
-    resolve(*this);
+    resolve_status(*this);
+    cache.record();
 
     printInfo(*this, kind);
 
@@ -4927,6 +5489,19 @@ void Zypper::doCommand()
     break;
   }
 
+  case ZypperCommand::BATCH_e:
+  {
+    if (runningHelp())
+      out().info(_command_help, Out::QUIET);
+    else
+    {
+      out().error(_("The batch command can't be used in the zypper shell."));
+      setExitCode(ZYPPER_EXIT_ERR_INVALID_ARGS);
+    }
+
+    break;
+  }
+
   case ZypperCommand::RUG_SERVICE_TYPES_e:
   {
     if (runningHelp()) { out().info(_command_help, Out::QUIET); return; }
@@ -42,6 +42,8 @@ using std::endl;
  */
 #define ZYPPER_RPM_CACHE_DIR "/var/cache/zypper/RPMS"
 
+class RefreshStats;
+
 /** Base class for command specific option classes. */
 struct Options { virtual ~Options() {} };
 
@@ -127,6 +129,7 @@ struct RuntimeData
     , seen_verify_hint(false)
     , action_rpm_download(false)
     , waiting_for_input(false)
+    , refresh_stats(NULL)
   {}
 
   std::list<zypp::RepoInfo> repos;
@@ -174,6 +177,9 @@ struct RuntimeData
   //! \todo move this to a separate Status struct
   bool waiting_for_input;
 
+  /** Refresh statistics to fill in (refresh --stats), NULL if not wanted. */
+  RefreshStats * refresh_stats;
+
   //! Temporary directory for any use. Used e.g. as packagesPath of TMP_RPM_REPO_ALIAS repository.
   zypp::filesystem::TmpDir tmpdir;
 };
@@ -190,6 +196,15 @@ public:
 
   int main(int argc, char ** argv);
 
+  /**
+   * Run the command given by \a argc and \a argv on behalf of a zypperd
+   * client, on the already loaded pool.
+   *
+   * \return exit code of the command, ZYPPERD_EXIT_REFUSED if it needs
+   *         a differently loaded pool
+   */
+  int daemonCommand(int argc, char ** argv);
+
   // setters & getters
   Out & out();
   void setOutputWriter(Out * out) { _out_ptr = out; }
@@ -212,6 +227,7 @@ public:
   void setExitCode(int exit) { _exit_code = exit; }
   bool runningShell() const { return _running_shell; }
   bool runningHelp() const { return _running_help; }
+  bool runningDaemon() const { return _running_daemon; }
   bool exitRequested() const { return _exit_requested; }
   void requestExit(bool do_exit = true) { _exit_requested = do_exit; }
 
@@ -263,6 +279,7 @@ private:
   void processGlobalOptions();
   void processCommandOptions();
   void commandShell();
+  void commandBatch();
   void shellCleanup();
   void safeDoCommand();
   void doCommand();
@@ -287,6 +304,7 @@ private:
   int   _exit_code;
   bool  _running_shell;
   bool  _running_help;
+  bool  _running_daemon;
   bool  _exit_requested;
 
   RuntimeData _rdata;
@@ -296,6 +314,9 @@ private:
   int _sh_argc;
   char **_sh_argv;
 
+  /** File with the commands for 'zypper batch', '-' for stdin. */
+  std::string _batch_file;
+
   /** Command specific options (see also _copts). */
   shared_ptr<Options>  _commandOptions;
 };
@@ -26,6 +26,7 @@
 #include "utils/misc.h" // for kind_to_string_localized and string_patch_status
 #include "utils/text.h"
 #include "search.h"
+#include "Suggestions.h"
 #include "update.h"
 
 #include "info.h"
@@ -115,6 +116,8 @@ void printInfo(Zypper & zypper, const ResKind & kind)
       cout << "\n" << format(_("%s '%s' not found."))
           % kind_to_string_localized(kind, 1) % *nameit
           << endl;
+      if ( (*nameit).find_first_of("?*") == string::npos )
+        print_similar_names(zypper, *nameit, kind);
     }
     else
     {
@@ -3,6 +3,7 @@
 
 #include <zypp/base/String.h>
 #include <zypp/base/Logger.h>
+#include <zypp/ZYppFactory.h>
 #include <zypp/Locks.h>
 
 #include "output/Out.h"
@@ -15,6 +16,8 @@
 using namespace zypp;
 using namespace std;
 
+extern ZYpp::Ptr God;
+
 static const string
 get_string_for_table(const set<string> & attrvals)
 {
@@ -251,3 +254,32 @@ void remove_locks(Zypper & zypper, const Zypper::ArgList & args, const ResKindSe
     zypper.setExitCode(ZYPPER_EXIT_ERR_ZYPP);
   }
 }
+
+void reload_locks(Zypper & zypper)
+{
+  // zypp is not initialized if the command failed early, see remove_selections
+  if (!God)
+    return;
+
+  MIL << "Applying the package locks again" << endl;
+
+  // the pool is kept across shell commands, drop the locks of the previous
+  // lock file and apply the current one
+  const ResPool & pool = God->pool();
+  for_(it, pool.begin(), pool.end())
+    if (it->status().isLocked())
+      it->status().setLock(false, ResStatus::USER);
+
+  try
+  {
+    Locks & locks = Locks::instance();
+    locks.read(Pathname::assertprefix
+        (zypper.globalOpts().root_dir, ZConfig::instance().locksFile()));
+    locks.apply();
+  }
+  catch(const Exception & e)
+  {
+    ZYPP_CAUGHT(e);
+    WAR << "Could not apply the package locks." << endl;
+  }
+}
@@ -6,5 +6,7 @@
 void list_locks(Zypper & zypper);
 void add_locks(Zypper & zypper, const Zypper::ArgList & args, const ResKindSet & kinds);
 void remove_locks(Zypper & zypper, const Zypper::ArgList & args, const ResKindSet & kinds);
+/** Applies the current lock file to the pool kept by zypper shell. */
+void reload_locks(Zypper & zypper);
 
 #endif /*ZYPPERLOCKS_H_*/
@@ -15,6 +15,8 @@
 #include "callbacks/locks.h"
 #include "output/OutNormal.h"
 #include "utils/messages.h"
+#include "utils/Profiler.h"
+#include "utils/ProcessPool.h"
 
 using namespace std;
 
@@ -53,6 +55,12 @@ void signal_handler(int sig)
 }
 
 
+/** Stop request of the jobs in worker processes, see ProcessPool. */
+static void job_stop_request()
+{
+  Zypper::instance()->requestExit();
+}
+
 int main(int argc, char **argv)
 {
   struct Bye {
@@ -81,6 +89,8 @@ int main(int argc, char **argv)
     out.error("Failed to set SIGINT handler.");
   if (::signal(SIGTERM, signal_handler) == SIG_ERR)
     out.error("Failed to set SIGTERM handler.");
+  // worker processes get their own handler, which only requests exit
+  ProcessPool::setStopRequest(job_stop_request);
 
   try
   {
@@ -106,5 +116,11 @@ int main(int argc, char **argv)
     return ZYPPER_EXIT_ERR_BUG;
   }
 
-  return Zypper::instance()->main(argc, argv);
+  int ret;
+  {
+    ProfileScope profile("zypper");
+    ret = Zypper::instance()->main(argc, argv);
+  }
+  Profiler::instance().write();
+  return ret;
 }
@@ -23,6 +23,7 @@
 #define ZYPPER_EXIT_INF_RESTART_NEEDED     103 // restart of package manager itself needed
 #define ZYPPER_EXIT_INF_CAP_NOT_FOUND      104 // given capability not found (for install/remove)
 #define ZYPPER_EXIT_ON_SIGNAL              105 // SIGINT or SIGTERM received
+#define ZYPPER_EXIT_INF_REFRESH_DEADLINE   106 // some repos not refreshed within refresh --deadline
 
 // undefine _ and _PL macros from libzypp
 #ifdef _
@@ -116,6 +116,11 @@ void Out::searchResult( const Table & table_r )
   std::cout << table_r;
 }
 
+void Out::searchResultRow( const TableHeader & header_r, const TableRow & row_r )
+{
+  row_r.dumbDumpTo( std::cout );
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //	class Out::Error
 ////////////////////////////////////////////////////////////////////////////////
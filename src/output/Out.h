@@ -22,6 +22,8 @@
 using namespace zypp;
 
 class Table;
+class TableRow;
+class TableHeader;
 class Zypper;
 
 ///////////////////////////////////////////////////////////////////
@@ -588,6 +590,29 @@ public:
    */
   virtual void searchResult( const Table & table_r );
 
+  /**
+   * Whether search results are printed row by row as they are found
+   * (\ref searchResultRow), rather than collected, sorted, and printed by
+   * \ref searchResult. Default is \c false.
+   */
+  virtual bool streamsSearchResult() const
+  { return false; }
+
+  /**
+   * Print a row of a search result right away. The first row starts the
+   * result, \ref searchResultEnd ends it.
+   *
+   * Default implementation prints \a row_r tab separated on \c stdout.
+   *
+   * \param header_r The header of the result table.
+   * \param row_r    The row to print.
+   */
+  virtual void searchResultRow( const TableHeader & header_r, const TableRow & row_r );
+
+  /** End a search result printed by \ref searchResultRow. */
+  virtual void searchResultEnd()
+  {}
+
   /**
    * Prompt the user for a decision.
    *
@@ -5,6 +5,7 @@
 #include <zypp/base/String.h>
 #include <zypp/base/String.h>
 
+#include "main.h"
 #include "OutXML.h"
 #include "utils/misc.h"
 #include "Table.h"
@@ -190,63 +191,71 @@ void OutXML::dwnldProgressEnd(const zypp::Url & uri, long rate, bool error)
 
 void OutXML::searchResult( const Table & table_r )
 {
-  cout << "<search-result version=\"0.0\">" << endl;
-  cout << "<solvable-list>" << endl;
+  if ( table_r.empty() )
+  {
+    cout << "<search-result version=\"0.0\">" << endl;
+    cout << "<solvable-list>" << endl;
+  }
+  for ( unsigned i = 0; i < table_r.size(); ++i )
+    searchResultRow( table_r.header(), table_r.row( i ) );
+  searchResultEnd();
+}
 
-  const Table::container & rows( table_r.rows() );
-  if ( ! rows.empty() )
+void OutXML::searchResultRow( const TableHeader & header_r, const TableRow & row_r )
+{
+  std::vector<std::string> & header( _search_attrs );
+  if ( header.empty() )
   {
+    cout << "<search-result version=\"0.0\">" << endl;
+    cout << "<solvable-list>" << endl;
+
     //
     // *** CAUTION: It's a mess, but must match the header list defined
     //              in FillSearchTableSolvable ctor (search.cc)
     // We derive the XML tag from the header, applying some translation
     // hence and there.
-    std::vector<std::string> header;
+    for_( it, header_r.columns().begin(), header_r.columns().end() )
     {
-      const TableHeader & theader( table_r.header() );
-      for_( it, theader.columns().begin(), theader.columns().end() )
-      {
-	if ( *it == "S" )
-	  header.push_back( "status" );
-	else if ( *it == "Type" )
-	  header.push_back( "kind" );
-	else if ( *it == "Version" )
-	  header.push_back( "edition" );
-	else
-	  header.push_back( zypp::str::toLower( *it ) );
-      }
+      if ( *it == "S" || *it == _("S") )	// missing with search --no-status
+	header.push_back( "status" );
+      else if ( *it == "Type" )
+	header.push_back( "kind" );
+      else if ( *it == "Version" )
+	header.push_back( "edition" );
+      else
+	header.push_back( zypp::str::toLower( *it ) );
     }
+  }
 
-    for_( it, rows.begin(), rows.end() )
+  cout << "<solvable";
+  const TableRow::container & cols( row_r.columns() );
+  unsigned cidx = 0;
+  for_( cit, cols.begin(), cols.end() )
+  {
+    cout << ' ' << (cidx < header.size() ? header[cidx] : "?" ) << "=\"";
+    if ( cidx < header.size() && header[cidx] == "status" )	// not with search --no-status
+    {
+      if ( *cit == "i" )
+	cout << "installed\"";
+      else if ( *cit == "v" )
+	cout << "other-version\"";
+      else
+	cout << "not-installed\"";
+    }
+    else
     {
-      cout << "<solvable";
-      const TableRow::container & cols( it->columns() );
-      unsigned cidx = 0;
-      for_( cit, cols.begin(), cols.end() )
-      {
-	cout << ' ' << (cidx < header.size() ? header[cidx] : "?" ) << "=\"";
-	if ( cidx == 0 )
-	{
-	  if ( *cit == "i" )
-	    cout << "installed\"";
-	  else if ( *cit == "v" )
-	    cout << "other-version\"";
-	  else
-	    cout << "not-installed\"";
-	}
-	else
-	{
-	  cout << xml::escape(*cit) << '"';
-	}
-	++cidx;
-      }
-      cout << "/>" << endl;
+      cout << xml::escape(*cit) << '"';
     }
+    ++cidx;
   }
-    //Out::searchResult( table_r );
+  cout << "/>" << endl;
+}
 
+void OutXML::searchResultEnd()
+{
   cout << "</solvable-list>" << endl;
   cout << "</search-result>" << endl;
+  _search_attrs.clear();
 }
 
 void OutXML::prompt(PromptId id,
@@ -1,6 +1,9 @@
 #ifndef OUTXML_H_
 #define OUTXML_H_
 
+#include <string>
+#include <vector>
+
 #include "Out.h"
 
 class OutXML : public Out
@@ -38,6 +41,10 @@ public:
                                 bool error = false);
 
   virtual void searchResult( const Table & table_r );
+  virtual bool streamsSearchResult() const
+  { return true; }
+  virtual void searchResultRow( const TableHeader & header_r, const TableRow & row_r );
+  virtual void searchResultEnd();
 
   virtual void prompt(PromptId id,
                       const std::string & prompt,
@@ -54,6 +61,10 @@ private:
   void writeProgressTag(const std::string & id,
                         const std::string & label,
                         int value, bool done, bool error = false);
+
+  /** The attribute names for the columns of the search result being
+   * printed, empty if none is. */
+  std::vector<std::string> _search_attrs;
 };
 
 #endif /*OUTXML_H_*/
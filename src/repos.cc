@@ -7,16 +7,24 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <boost/logic/tribool.hpp>
 #include <boost/lexical_cast.hpp>
 #include <iterator>
 #include <list>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <limits>
+#include <cerrno>
+#include <csignal>
 
 #include <zypp/ZYpp.h>
 #include <zypp/base/Logger.h>
 #include <zypp/base/IOStream.h>
 #include <zypp/base/String.h>
 #include <zypp/base/Flags.h>
+#include <zypp/PathInfo.h>
 
 #include <zypp/RepoManager.h>
 #include <zypp/repo/RepoException.h>
@@ -25,12 +33,19 @@
 #include <zypp/media/MediaAccess.h>
 
 #include "output/Out.h"
+#include "output/OutNormal.h"
 #include "main.h"
 #include "getopt.h"
 #include "Table.h"
 #include "utils/messages.h"
 #include "utils/misc.h"
+#include "utils/FilePrefetcher.h"
+#include "utils/ProcessPool.h"
+#include "utils/Profiler.h"
 #include "repos.h"
+#include "RefreshStats.h"
+#include "SearchIndex.h"
+#include "zypp-refresh.h"
 
 using namespace std;
 using namespace boost;
@@ -57,9 +72,15 @@ void safe_lexical_cast (Source s, Target &tr) {
 
 // ----------------------------------------------------------------------------
 
+/**
+ * \param check whether to check if the refresh is needed at all. Pass false
+ *              if this has already been checked and a refresh is needed.
+ * \return false on success, true on error
+ */
 static bool refresh_raw_metadata(Zypper & zypper,
                                  const RepoInfo & repo,
-                                 bool force_download)
+                                 bool force_download,
+                                 bool check = true)
 {
   RuntimeData & gData = zypper.runtimeData();
   gData.current_repo = repo;
@@ -74,8 +95,14 @@ static bool refresh_raw_metadata(Zypper & zypper,
 
   try
   {
-    if (!force_download)
+    if (!force_download && !check)
+    {
+      MIL << "up-to-date check already done, refresh needed" << endl;
+      do_refresh = true;
+    }
+    else if (!force_download)
     {
+      RefreshPhaseTimer timer(zypper, repo, RepoRefreshStats::CHECK);
       // check whether libzypp indicates a refresh is needed, and if so,
       // print a message
       zypper.out().info(boost::str(format(
@@ -96,6 +123,8 @@ static bool refresh_raw_metadata(Zypper & zypper,
                     RepoManager::RefreshIfNeededIgnoreDelay :
                     RepoManager::RefreshIfNeeded);
             do_refresh = (stat == RepoManager::REFRESH_NEEDED);
+            if (timer.stats())
+              timer.stats()->url = it->asString();
             if (!do_refresh &&
                 (zypper.command() == ZypperCommand::REFRESH ||
                  zypper.command() == ZypperCommand::REFRESH_SERVICES))
@@ -142,8 +171,13 @@ static bool refresh_raw_metadata(Zypper & zypper,
           _("Retrieving repository '%s' metadata"), show_alias ? repo.alias().c_str() : repo.name().c_str());
       zypper.out().progressStart("raw-refresh", plabel, true);
 
+      RefreshPhaseTimer timer(zypper, repo, RepoRefreshStats::DOWNLOAD);
+      scoped_ptr<RefreshDownloadCounter> counter;
+      if (timer.stats())
+        counter.reset(new RefreshDownloadCounter(*timer.stats()));
+
       manager.refreshMetadata(repo,
-        force_download ?
+        force_download || !check ?
           RepoManager::RefreshForced :
             zypper.command() == ZypperCommand::REFRESH ||
             zypper.command() == ZypperCommand::REFRESH_SERVICES ?
@@ -278,6 +312,7 @@ static bool build_cache(Zypper & zypper, const RepoInfo &repo, bool force_build)
   if (force_build)
     zypper.out().info(_("Forcing building of repository cache"));
 
+  RefreshPhaseTimer timer(zypper, repo, RepoRefreshStats::BUILD);
   try
   {
     RepoManager & manager = zypper.repoManager();
@@ -288,13 +323,17 @@ static bool build_cache(Zypper & zypper, const RepoInfo &repo, bool force_build)
     // version of satsolver-tools. If there's a version mismatch or some other
     // problem, the solv file will be rebuilt even though the cookie files
     // indicate the solv file is up to date with raw metadata (bnc #456718)
-    if (!force_build &&
-        // only do this if the refresh commands are running
+    // A forced build needs the repo loaded too, for the search indexes.
+    if (// only do this if the refresh commands are running
         // this function is also used when loading repos for other commands
-        (zypper.command() == ZypperCommand::REFRESH
-         || zypper.command() == ZypperCommand::REFRESH_SERVICES))
+        zypper.command() == ZypperCommand::REFRESH
+        || zypper.command() == ZypperCommand::REFRESH_SERVICES)
     {
       manager.loadFromCache(repo);
+      // the repo is loaded now, (re)build the search indexes if needed
+      sat::Repository loaded(sat::Pool::instance().reposFind(repo.alias()));
+      if (loaded != sat::Repository::noRepository)
+        update_search_indexes(zypper, loaded);
     }
   }
   catch (const parser::ParseException & e)
@@ -575,6 +614,243 @@ unsigned repo_specs_to_aliases(Zypper & zypper,
 
 // ---------------------------------------------------------------------------
 
+/**
+ * Prepare the output of a forked refresh worker. The captured output is
+ * replayed by the parent later, thus it must not contain the self-overwriting
+ * progress lines the parent's writer would produce on a terminal. Workers
+ * can't ask the user, so they get the default answers.
+ */
+static void init_refresh_worker(Zypper & zypper)
+{
+  if (zypper.out().type() == Out::TYPE_NORMAL)
+  {
+    // the parent's writer is left alone, the worker will _exit() soon
+    OutNormal * p = new OutNormal(zypper.out().verbosity());
+    p->setUseColors(zypper.config().do_colors);
+    zypper.setOutputWriter(p);
+  }
+  zypper.globalOptsNoConst().non_interactive = true;
+}
+
+// ---------------------------------------------------------------------------
+
+/** Max number of concurrent up-to-date checks in \ref check_autorefresh_repos(). */
+#define AUTOREFRESH_CHECK_JOBS 10
+
+/** Result of the up-to-date check of an autorefresh repo. */
+enum AutorefreshCheck
+{
+  /** The raw metadata are up to date (or the check has been delayed). */
+  AUTOREFRESH_UP_TO_DATE = 0,
+  /** The raw metadata need to be refreshed. */
+  AUTOREFRESH_NEEDED = 1,
+  /** The check failed. The regular refresh will retry and report it. */
+  AUTOREFRESH_FAILED = 2,
+  /** The check did not finish before the deadline. */
+  AUTOREFRESH_TIMED_OUT = 3
+};
+
+/**
+ * Check whether \a repo needs a refresh. Meant to be run in a worker process.
+ * Tries the base URLs in order until one of them can be checked, like
+ * \ref refresh_raw_metadata() does.
+ */
+static AutorefreshCheck autorefresh_check_repo(Zypper & zypper, const RepoInfo & repo)
+{
+  RepoManager & manager = zypper.repoManager();
+  for_(it, repo.baseUrlsBegin(), repo.baseUrlsEnd())
+  {
+    try
+    {
+      if (manager.checkIfToRefreshMetadata(repo, *it, RepoManager::RefreshIfNeeded)
+          == RepoManager::REFRESH_NEEDED)
+        return AUTOREFRESH_NEEDED;
+      return AUTOREFRESH_UP_TO_DATE;
+    }
+    catch (const Exception & e)
+    {
+      ZYPP_CAUGHT(e);
+      ERR << *it << " doesn't look good." << endl;
+    }
+  }
+  return AUTOREFRESH_FAILED;
+}
+
+/**
+ * Do the up-to-date checks of \a repos concurrently, so that the (mostly
+ * remote) round-trips do not add up. The checks which do not finish within
+ * \a timeout seconds in total are stopped.
+ *
+ * \return map of repo aliases to the check results
+ */
+static map<string, AutorefreshCheck> check_autorefresh_repos(
+    Zypper & zypper, const list<RepoInfo> & repos, unsigned timeout)
+{
+  MIL << "checking " << repos.size() << " repos, timeout " << timeout << "s" << endl;
+
+  map<string, AutorefreshCheck> result;
+  vector<pair<string, unsigned> > ids;
+  ProcessPool pool(AUTOREFRESH_CHECK_JOBS);
+  time_t deadline = ::time(NULL) + timeout;
+
+  for_(it, repos.begin(), repos.end())
+  {
+    // wait for a free slot here, so that the job gets only the rest of the time
+    while (pool.running() >= pool.maxJobs())
+      pool.waitAny();
+
+    time_t now = ::time(NULL);
+    if (now >= deadline)
+    {
+      result[it->alias()] = AUTOREFRESH_TIMED_OUT;
+      continue;
+    }
+
+    RepoInfo repo(*it);
+    ids.push_back(make_pair(repo.alias(), pool.start([&zypper, repo]() -> int {
+      init_refresh_worker(zypper);
+      return autorefresh_check_repo(zypper, repo);
+    }, deadline - now)));
+  }
+
+  for_(it, ids.begin(), ids.end())
+  {
+    const ProcessPool::Result & res(pool.wait(it->second));
+    if (res.timedout)
+      result[it->first] = AUTOREFRESH_TIMED_OUT;
+    else if (res.status == AUTOREFRESH_UP_TO_DATE || res.status == AUTOREFRESH_NEEDED)
+      result[it->first] = (AutorefreshCheck) res.status;
+    else
+      result[it->first] = AUTOREFRESH_FAILED;
+    DBG << it->first << ": " << result[it->first] << endl;
+  }
+
+  return result;
+}
+
+// ---------------------------------------------------------------------------
+
+/** Max number of services refreshed at once by \ref refresh_services_parallel(). */
+#define SERVICE_REFRESH_JOBS 5
+
+/**
+ * Refresh \a services concurrently, each in a worker process which is stopped
+ * if it does not finish within main/serviceRefreshTimeout seconds. Output
+ * of the workers is replayed in the order of \a services.
+ *
+ * A stopped worker gets SIGTERM first, which aborts its download but lets
+ * libzypp finish the .repo or .service file it is writing, see
+ * \ref ProcessPool::start(). The service may be left half refreshed then:
+ * some of its repos added, removed or changed, the rest not, and its last
+ * refresh time not updated, so the next refresh does it again.
+ *
+ * The workers modify the repos on disk only, so the caller needs to
+ * reinitialize the repo manager afterwards (once for all the services).
+ *
+ * \return aliases of the services which could not be refreshed
+ */
+static set<string> refresh_services_parallel(
+    Zypper & zypper, const list<ServiceInfo> & services)
+{
+  unsigned timeout = zypper.config().service_refresh_timeout;
+  MIL << "going to refresh " << services.size() << " services, timeout "
+      << timeout << "s" << endl;
+
+  set<string> failed;
+  vector<ServiceInfo> torefresh(services.begin(), services.end());
+  vector<unsigned> ids;
+  ProcessPool pool(SERVICE_REFRESH_JOBS);
+
+  for (unsigned next_report = 0; next_report < torefresh.size(); )
+  {
+    while (ids.size() < torefresh.size() && pool.running() < pool.maxJobs())
+    {
+      ServiceInfo service(torefresh[ids.size()]);
+      ids.push_back(pool.start([&zypper, service]() -> int {
+        init_refresh_worker(zypper);
+        return refresh_service(zypper, service) ? 1 : 0;
+      }, timeout));
+    }
+
+    if (!pool.finished(ids[next_report]))
+    {
+      pool.waitAny();
+      continue;
+    }
+
+    const ServiceInfo & service(torefresh[next_report]);
+    const ProcessPool::Result & result(pool.result(ids[next_report]));
+    cout << result.output << flush;
+    if (result.timedout)
+      zypper.out().error(str::form(
+          _("Refreshing service '%s' did not finish within %u seconds."),
+          (zypper.config().show_alias ? service.alias().c_str() : service.name().c_str()),
+          timeout));
+    if (result.timedout || result.status != 0)
+    {
+      failed.insert(service.alias());
+      zypper.setExitCode(ZYPPER_EXIT_ERR_ZYPP);
+    }
+    ++next_report;
+  }
+
+  return failed;
+}
+
+// ---------------------------------------------------------------------------
+
+bool refresh_daemon_running()
+{
+  ifstream in(ZYPP_REFRESH_STATUS_FILE);
+  string key;
+  pid_t pid = 0;
+  while (in >> key)
+  {
+    if (key == "pid")
+    {
+      in >> pid;
+      break;
+    }
+    in.ignore(numeric_limits<streamsize>::max(), '\n');
+  }
+
+  if (pid <= 0)
+    return false;
+  if (::kill(pid, 0) == 0 || errno == EPERM)
+    return true;
+
+  DBG << "stale " << ZYPP_REFRESH_STATUS_FILE << ", pid " << pid << endl;
+  return false;
+}
+
+/**
+ * Aliases of the repos the zypp-refresh daemon has refreshed successfully
+ * and whose next check is not due yet, according to its status file.
+ */
+static set<string> refresh_daemon_fresh_repos()
+{
+  set<string> result;
+  ifstream in(ZYPP_REFRESH_STATUS_FILE);
+  time_t now = ::time(NULL);
+  string line;
+  while (getline(in, line))
+  {
+    istringstream str(line);
+    string key, status, alias;
+    time_t last_check = 0, next_check = 0;
+    str >> key;
+    if (key != "repo")
+      continue;
+    str >> last_check >> next_check >> status >> ws;
+    getline(str, alias);
+    if (!alias.empty() && status == "ok" && now < next_check)
+      result.insert(alias);
+  }
+  return result;
+}
+
+// ---------------------------------------------------------------------------
+
 /**
  * Fill gData.repositories with active repos (enabled or specified) and refresh
  * if autorefresh is on.
@@ -593,18 +869,17 @@ void do_init_repos(Zypper & zypper, const Container & container)
     MIL << "Refreshing autorefresh services." << endl;
 
     const list<ServiceInfo> & services = zypper.repoManager().knownServices();
-    bool called_refresh = false;
+    list<ServiceInfo> torefresh;
     for_(s, services.begin(), services.end())
-    {
       if (s->enabled() && s->autorefresh())
-      {
-        refresh_service(zypper, *s);
-        called_refresh = true;
-      }
-    }
-    // reinitialize the repo manager to re-read the list of repos
-    if (called_refresh)
+        torefresh.push_back(*s);
+
+    if (!torefresh.empty())
+    {
+      refresh_services_parallel(zypper, torefresh);
+      // reinitialize the repo manager to re-read the list of repos
       zypper.initRepoManager();
+    }
   }
 
   MIL << "Going to initialize repositories." << endl;
@@ -669,6 +944,41 @@ void do_init_repos(Zypper & zypper, const Container & container)
       ++it;
   }
 
+  // the background refresher keeps the caches of the repos it has refreshed
+  // warm, no need to check those; the rest (new repos, failed refreshes,
+  // missing caches) are autorefreshed as usual
+  bool no_refresh = zypper.globalOpts().no_refresh;
+  set<string> daemon_fresh;
+  if (!no_refresh && !zypper.globalOpts().changedRoot && refresh_daemon_running())
+  {
+    set<string> fresh(refresh_daemon_fresh_repos());
+    for_(it, gData.repos.begin(), gData.repos.end())
+      if (fresh.find(it->alias()) != fresh.end() && !manager.metadataStatus(*it).empty())
+        daemon_fresh.insert(it->alias());
+    MIL << "zypp-refresh daemon is running, skipping autorefresh of "
+        << daemon_fresh.size() << " repos" << endl;
+    if (!daemon_fresh.empty())
+      zypper.out().info(_("Skipping autorefresh of the repositories refreshed"
+          " by the zypp-refresh daemon."), Out::HIGH);
+  }
+
+  // do the up-to-date checks of the autorefresh repos at once, so that only
+  // the stale ones need to be visited one by one
+  map<string, AutorefreshCheck> checked;
+  unsigned check_timeout = zypper.config().refresh_check_timeout;
+  if (geteuid() == 0 && !zypper.globalOpts().changedRoot
+      && !no_refresh && check_timeout)
+  {
+    list<RepoInfo> tocheck;
+    for_(it, gData.repos.begin(), gData.repos.end())
+      if (it->enabled() && it->autorefresh() && !it->baseUrlsEmpty()
+          && !is_changeable_media(it->url())
+          && daemon_fresh.find(it->alias()) == daemon_fresh.end())
+        tocheck.push_back(*it);
+    if (tocheck.size() > 1)
+      checked = check_autorefresh_repos(zypper, tocheck, check_timeout);
+  }
+
   for (std::list<RepoInfo>::iterator it = gData.repos.begin();
        it !=  gData.repos.end(); ++it)
   {
@@ -678,7 +988,8 @@ void do_init_repos(Zypper & zypper, const Container & container)
     bool do_refresh =
       repo.enabled() &&
       repo.autorefresh() &&
-      !zypper.globalOpts().no_refresh;
+      !no_refresh &&
+      daemon_fresh.find(repo.alias()) == daemon_fresh.end();
 
     if (do_refresh)
     {
@@ -687,8 +998,25 @@ void do_init_repos(Zypper & zypper, const Container & container)
       // handle root user differently
       if (geteuid() == 0 && !zypper.globalOpts().changedRoot)
       {
-        if (refresh_raw_metadata(zypper, repo, false)
-            || build_cache(zypper, repo, false))
+        bool error = false;
+        map<string, AutorefreshCheck>::const_iterator check = checked.find(repo.alias());
+        if (check == checked.end() || check->second == AUTOREFRESH_FAILED)
+          error = refresh_raw_metadata(zypper, repo, false);
+        else if (check->second == AUTOREFRESH_NEEDED)
+          error = refresh_raw_metadata(zypper, repo, false, false);
+        else if (check->second == AUTOREFRESH_TIMED_OUT)
+        {
+          WAR << "up-to-date check of " << repo.alias() << " timed out" << endl;
+          // nothing cached to fall back to, refresh as if not checked
+          if (manager.metadataStatus(repo).empty())
+            error = refresh_raw_metadata(zypper, repo, false);
+          else
+            zypper.out().warning(boost::str(format(
+                _("The up-to-date check of '%s' did not finish in time, using the cached metadata."))
+                % (zypper.config().show_alias ? repo.alias() : repo.name())));
+        }
+
+        if (error || build_cache(zypper, repo, false))
         {
           zypper.out().info(boost::str(format(
               _("Disabling repository '%s' because of the above error."))
@@ -771,18 +1099,27 @@ void init_repos(Zypper & zypper)
 { init_repos(zypper, std::vector<std::string>()); }
 
 
+// What has already been read in this process. The shell keeps these
+// across commands, see reset_repos() and reload_target_resolvables().
+static bool repos_initialized = false;
+static bool repo_resolvables_loaded = false;
+static bool target_resolvables_loaded = false;
+// rpmdb_stamp() when the target resolvables were loaded
+static string target_rpmdb_stamp;
+
 template <typename Container>
 void init_repos(Zypper & zypper, const Container & container)
 {
-  static bool done = false;
-  //! \todo this has to be done so that it works in zypper shell
-  if (done)
+  if (repos_initialized)
     return;
 
   if ( !zypper.globalOpts().disable_system_sources )
+  {
+    ProfileScope profile("init_repos");
     do_init_repos(zypper, container);
+  }
 
-  done = true;
+  repos_initialized = true;
 }
 
 // ----------------------------------------------------------------------------
@@ -792,6 +1129,7 @@ void init_target (Zypper & zypper)
   static bool done = false;
   if (!done)
   {
+    ProfileScope profile("init_target");
     zypper.out().info(_("Initializing Target"), Out::HIGH);
     MIL << "Initializing target" << endl;
 
@@ -1184,6 +1522,294 @@ void list_repos(Zypper & zypper)
 
 // ----------------------------------------------------------------------------
 
+/**
+ * Raw metadata download stage of \ref refresh_repo().
+ * \return false on success, true on error
+ */
+static bool refresh_repo_download(Zypper & zypper, const RepoInfo & repo)
+{
+  if (zypper.cOpts().count("build-only"))
+    return false;
+
+  bool force_download =
+    zypper.cOpts().count("force") || zypper.cOpts().count("force-download");
+
+    ///////////////////////////////////////////////////////////////////
+    // ma: Actually the block below should not be necessary. libzypp asks for
+    // the CD/DVD only if no raw metadata are cached. Once the raw metadata are
+    // present, no refresh takes place. We may just rebuild the solv file in case
+    // it was lost, damaged or has an old format. If this does not work, fix libzypp!
+#if 0
+    // without this a cd is required to be present in the drive on each refresh
+    // (or more 'refresh needed' check)
+    bool is_cd = is_changeable_media(repo.url());
+    if (!force_download && is_cd)
+    {
+      MIL << "Skipping refresh of a changeable read-only media." << endl;
+      return false;
+    }
+#endif
+    ///////////////////////////////////////////////////////////////////
+
+  MIL << "calling refreshMetadata" << (force_download ? ", forced" : "")
+      << endl;
+
+  return refresh_raw_metadata(zypper, repo, force_download);
+}
+
+/**
+ * Solv cache building stage of \ref refresh_repo().
+ * \return false on success, true on error
+ */
+static bool refresh_repo_build(Zypper & zypper, const RepoInfo & repo)
+{
+  if (zypper.cOpts().count("download-only"))
+    return false;
+
+  bool force_build =
+    zypper.cOpts().count("force") || zypper.cOpts().count("force-build");
+
+  MIL << "calling buildCache" << (force_build ? ", forced" : "") << endl;
+
+  return build_cache(zypper, repo, force_build);
+}
+
+// ----------------------------------------------------------------------------
+
+static void report_refresh_error(Zypper & zypper, const RepoInfo & repo)
+{
+  if (zypper.runtimeData().refresh_stats)
+    zypper.runtimeData().refresh_stats->repo(repo).error = true;
+
+  zypper.out().error(boost::str(format(
+    _("Skipping repository '%s' because of the above error."))
+      % (zypper.config().show_alias ? repo.alias() : repo.name())));
+  ERR << format("Skipping repository '%s' because of the above error.")
+      % repo.alias() << endl;
+}
+
+// ----------------------------------------------------------------------------
+
+/**
+ * Refresh \a repos in a two-stage pipeline: up to \a jobs worker processes
+ * download raw metadata, while this process builds the solv caches from
+ * the already downloaded ones, in the order of \a repos. So the next repos
+ * are being downloaded while the current one is being parsed.
+ *
+ * Output of the workers is replayed in the order of \a repos right before
+ * building the respective cache. Workers are not allowed to get more than
+ * 2 * \a jobs repos ahead of the cache builder, which bounds the number of
+ * downloaded-but-not-yet-built repos (and their buffered output).
+ *
+ * Repos on changeable media (CD/DVD) may need user interaction, so they are
+ * refreshed entirely by this process when it is their turn. The same goes
+ * for --build-only, where there is nothing to download.
+ *
+ * \return number of repos which could not be refreshed
+ */
+static unsigned refresh_repos_parallel(
+    Zypper & zypper, const list<RepoInfo> & repos, unsigned jobs)
+{
+  MIL << "going to refresh " << repos.size() << " repos using "
+      << jobs << " download workers" << endl;
+
+  vector<RepoInfo> torefresh(repos.begin(), repos.end());
+  vector<unsigned> ids(torefresh.size(), ProcessPool::npos);
+  ProcessPool pool(jobs);
+  const unsigned max_ahead = 2 * jobs;
+  const bool build_only = zypper.cOpts().count("build-only");
+  unsigned error_count = 0;
+
+  for (unsigned next_start = 0, next_build = 0; next_build < torefresh.size(); )
+  {
+    // stage 1: keep the download workers busy
+    while (next_start < torefresh.size()
+           && next_start - next_build < max_ahead
+           && pool.running() < pool.maxJobs())
+    {
+      const RepoInfo & repo(torefresh[next_start]);
+      if (!build_only && !is_changeable_media(repo.url()))
+        ids[next_start] = pool.start([&zypper, repo]() -> int {
+          init_refresh_worker(zypper);
+          bool error = refresh_repo_download(zypper, repo);
+          if (zypper.runtimeData().refresh_stats)
+            ProcessPool::jobData(zypper.runtimeData().refresh_stats->repo(repo).serialize());
+          return error ? 1 : 0;
+        });
+      ++next_start;
+    }
+
+    // stage 2: build the cache of the next repo in order
+    const RepoInfo & repo(torefresh[next_build]);
+    bool error = false;
+    if (ids[next_build] == ProcessPool::npos)
+      error = refresh_repo(zypper, repo);
+    else if (pool.finished(ids[next_build]))
+    {
+      const ProcessPool::Result & result(pool.result(ids[next_build]));
+      cout << result.output << flush;
+      RepoRefreshStats stats;
+      if (zypper.runtimeData().refresh_stats && stats.deserialize(result.data))
+        zypper.runtimeData().refresh_stats->repo(repo).merge(stats);
+      error = result.status != 0 || refresh_repo_build(zypper, repo);
+    }
+    else
+    {
+      pool.waitAny();
+      continue;
+    }
+
+    if (error)
+    {
+      report_refresh_error(zypper, repo);
+      ++error_count;
+    }
+    ++next_build;
+  }
+
+  return error_count;
+}
+
+// ----------------------------------------------------------------------------
+
+/** File keeping the wall time of the last refresh of each repo,
+ * as '<seconds> <alias>' lines. */
+#define ZYPPER_REFRESH_COSTS_FILE "/var/cache/zypper/refresh-costs"
+
+typedef map<string, double> RefreshCosts;
+
+static RefreshCosts read_refresh_costs()
+{
+  RefreshCosts costs;
+  ifstream in(ZYPPER_REFRESH_COSTS_FILE);
+  double seconds;
+  string alias;
+  while (in >> seconds >> ws && getline(in, alias))
+    costs[alias] = seconds;
+  return costs;
+}
+
+static void write_refresh_costs(const RefreshCosts & costs)
+{
+  filesystem::assert_dir(Pathname(ZYPPER_REFRESH_COSTS_FILE).dirname());
+  ofstream out(ZYPPER_REFRESH_COSTS_FILE);
+  for_(it, costs.begin(), costs.end())
+    out << it->second << " " << it->first << endl;
+  if (!out)
+    WAR << "Could not write " << ZYPPER_REFRESH_COSTS_FILE << endl;
+}
+
+/** Last observed refresh time of \a repo, -1 if unknown. */
+static double refresh_cost(const RefreshCosts & costs, const RepoInfo & repo)
+{
+  RefreshCosts::const_iterator it = costs.find(repo.alias());
+  return it == costs.end() ? -1 : it->second;
+}
+
+/**
+ * Refresh as many of \a repos as possible within \a budget seconds.
+ *
+ * The repos are refreshed in the order of their priority and, among repos
+ * of the same priority, starting with the cheapest one according to the
+ * refresh times observed in the previous runs. A repo whose last refresh
+ * time exceeds the rest of the budget is skipped, refreshes still running
+ * are sent SIGTERM up to ten seconds before the deadline and SIGKILL at
+ * it, so that none outlives the budget. The refreshes run in worker
+ * processes, at most \a jobs at a time. Each worker downloads and builds
+ * its repo, unlike in \ref refresh_repos_parallel(): a cache being built
+ * by this process could not be stopped at the deadline.
+ *
+ * \param stale gets the repos left unrefreshed because of the deadline
+ * \return number of repos which could not be refreshed because of an error
+ */
+static unsigned refresh_repos_deadline(
+    Zypper & zypper, const list<RepoInfo> & repos, unsigned budget,
+    unsigned jobs, list<RepoInfo> & stale)
+{
+  MIL << "going to refresh " << repos.size() << " repos within "
+      << budget << "s" << endl;
+
+  RefreshCosts costs(read_refresh_costs());
+  vector<RepoInfo> torefresh(repos.begin(), repos.end());
+  stable_sort(torefresh.begin(), torefresh.end(),
+    [&costs](const RepoInfo & lhs, const RepoInfo & rhs) -> bool {
+      if (lhs.priority() != rhs.priority())
+        return lhs.priority() < rhs.priority();
+      return refresh_cost(costs, lhs) < refresh_cost(costs, rhs);
+    });
+
+  vector<unsigned> ids(torefresh.size(), ProcessPool::npos);
+  ProcessPool pool(jobs);
+  time_t deadline = ::time(NULL) + budget;
+  unsigned error_count = 0;
+
+  for (unsigned next_start = 0, next_report = 0; next_report < torefresh.size(); )
+  {
+    while (next_start < torefresh.size() && pool.running() < pool.maxJobs())
+    {
+      const RepoInfo & repo(torefresh[next_start]);
+      time_t left = deadline - ::time(NULL);
+      double cost = refresh_cost(costs, repo);
+      if (left <= 0 || cost > left)
+        DBG << "no time left for " << repo.alias() << " (" << left
+            << "s left, last refresh took " << cost << "s)" << endl;
+      else
+      {
+        // stopped so that it is gone at the deadline, including the grace
+        // period between SIGTERM and SIGKILL
+        unsigned grace = min(unsigned(ProcessPool::kill_grace), unsigned(left / 2));
+        ids[next_start] = pool.start([&zypper, repo]() -> int {
+          init_refresh_worker(zypper);
+          bool error = refresh_repo(zypper, repo);
+          if (zypper.runtimeData().refresh_stats)
+            ProcessPool::jobData(zypper.runtimeData().refresh_stats->repo(repo).serialize());
+          return error ? 1 : 0;
+        }, left - grace, grace);
+      }
+      ++next_start;
+    }
+
+    const RepoInfo & repo(torefresh[next_report]);
+    if (ids[next_report] == ProcessPool::npos)
+      stale.push_back(repo);
+    else if (pool.finished(ids[next_report]))
+    {
+      const ProcessPool::Result & result(pool.result(ids[next_report]));
+      cout << result.output << flush;
+      // (none from a worker stopped at the deadline)
+      RepoRefreshStats stats;
+      if (zypper.runtimeData().refresh_stats && stats.deserialize(result.data))
+        zypper.runtimeData().refresh_stats->repo(repo).merge(stats);
+      if (result.timedout)
+      {
+        // the refresh takes at least this long
+        costs[repo.alias()] = max(result.seconds, refresh_cost(costs, repo));
+        stale.push_back(repo);
+      }
+      else
+      {
+        costs[repo.alias()] = result.seconds;
+        if (result.status != 0)
+        {
+          report_refresh_error(zypper, repo);
+          ++error_count;
+        }
+      }
+    }
+    else
+    {
+      pool.waitAny();
+      continue;
+    }
+    ++next_report;
+  }
+
+  write_refresh_costs(costs);
+  return error_count;
+}
+
+// ----------------------------------------------------------------------------
+
 void refresh_repos(Zypper & zypper)
 {
   MIL << "going to refresh repositories" << endl;
@@ -1223,8 +1849,53 @@ void refresh_repos(Zypper & zypper)
     s << it->alias() << " ";
   zypper.out().info(s.str(), Out::HIGH);
 
+  // number of worker processes for --parallel
+  unsigned jobs = 0;
+  if ((tmp1 = copts.find("parallel")) != copts.end())
+  {
+    str::strtonum(tmp1->second.front(), jobs);
+    if (jobs == 0)
+    {
+      zypper.out().error(boost::str(format(
+          _("Invalid number of parallel jobs '%s'.")) % tmp1->second.front()),
+          _("Specify a positive integer number."));
+      zypper.setExitCode(ZYPPER_EXIT_ERR_INVALID_ARGS);
+      return;
+    }
+  }
+
+  // time budget for --deadline
+  unsigned deadline = 0;
+  if ((tmp1 = copts.find("deadline")) != copts.end())
+  {
+    str::strtonum(tmp1->second.front(), deadline);
+    if (deadline == 0)
+    {
+      zypper.out().error(boost::str(format(
+          _("Invalid deadline '%s'.")) % tmp1->second.front()),
+          _("Specify a positive number of seconds."));
+      zypper.setExitCode(ZYPPER_EXIT_ERR_INVALID_ARGS);
+      return;
+    }
+  }
+
+  // refresh statistics
+  RefreshStats stats;
+  bool show_stats = copts.count("stats");
+  string stats_file;
+  if ((tmp1 = copts.find("stats-file")) != copts.end())
+    stats_file = tmp1->second.front();
+  if (show_stats || !stats_file.empty())
+    zypper.runtimeData().refresh_stats = &stats;
+  // don't leave a dangling pointer behind
+  struct Bye { ~Bye() { Zypper::instance()->runtimeData().refresh_stats = NULL; } } reset __attribute__ ((__unused__));
+
   unsigned error_count = 0;
   unsigned enabled_repo_count = repos.size();
+  // repos to be refreshed by the workers
+  list<RepoInfo> torefresh;
+  // repos skipped because of --deadline
+  list<RepoInfo> stale;
 
   if (!specified.empty() || not_found.empty())
   {
@@ -1269,21 +1940,50 @@ void refresh_repos(Zypper & zypper)
         continue;
       }
 
+      if (jobs || deadline)
+      {
+        torefresh.push_back(repo);
+        continue;
+      }
+
       // do the refresh
       if (refresh_repo(zypper, repo))
       {
-        zypper.out().error(boost::str(format(
-          _("Skipping repository '%s' because of the above error."))
-            % (zypper.config().show_alias ? repo.alias() : repo.name())));
-        ERR << format("Skipping repository '%s' because of the above error.")
-            % repo.alias() << endl;
+        report_refresh_error(zypper, repo);
         error_count++;
       }
     }
+
+    if (deadline && !torefresh.empty())
+      error_count += refresh_repos_deadline(zypper, torefresh, deadline, jobs ? jobs : 1, stale);
+    else if (!torefresh.empty())
+      error_count += refresh_repos_parallel(zypper, torefresh, jobs);
   }
   else
     enabled_repo_count = 0;
 
+  if (show_stats)
+    stats.print(zypper);
+  if (!stats_file.empty())
+  {
+    ofstream out(stats_file.c_str());
+    stats.dumpAsJsonOn(out);
+    if (!out)
+      zypper.out().error(boost::str(format(
+          _("Can't open %s for writing.")) % stats_file),
+        _("Maybe you do not have write permissions?"));
+  }
+
+  if (!stale.empty())
+  {
+    zypper.out().warning(str::form(
+        _("The following repositories could not be refreshed before the deadline of %u seconds:"),
+        deadline));
+    for_(it, stale.begin(), stale.end())
+      zypper.out().info(
+          zypper.config().show_alias ? it->alias() : it->name(), Out::QUIET);
+  }
+
   // print the result message
   if (enabled_repo_count == 0)
   {
@@ -1307,6 +2007,11 @@ void refresh_repos(Zypper & zypper)
     zypper.setExitCode(ZYPPER_EXIT_ERR_ZYPP);
     return;
   }
+  else if (!stale.empty())
+  {
+    zypper.out().info(_("Some of the repositories have not been refreshed because of the deadline."));
+    zypper.setExitCode(ZYPPER_EXIT_INF_REFRESH_DEADLINE);
+  }
   else if (!specified.empty())
     zypper.out().info(_("Specified repositories have been refreshed."));
   else
@@ -1320,48 +2025,8 @@ bool refresh_repo(Zypper & zypper, const zypp::RepoInfo & repo)
 {
   MIL << "going to refresh repo '" << repo.alias() << "'" << endl;
 
-  // raw metadata refresh
-  bool error = false;
-  if (!zypper.cOpts().count("build-only"))
-  {
-    bool force_download =
-      zypper.cOpts().count("force") || zypper.cOpts().count("force-download");
-
-      ///////////////////////////////////////////////////////////////////
-      // ma: Actually the block below should not be necessary. libzypp asks for
-      // the CD/DVD only if no raw metadata are cached. Once the raw metadata are
-      // present, no refresh takes place. We may just rebuild the solv file in case
-      // it was lost, damaged or has an old format. If this does not work, fix libzypp!
-#if 0
-      // without this a cd is required to be present in the drive on each refresh
-      // (or more 'refresh needed' check)
-      bool is_cd = is_changeable_media(repo.url());
-      if (!force_download && is_cd)
-      {
-	MIL << "Skipping refresh of a changeable read-only media." << endl;
-	return false;
-      }
-#endif
-      ///////////////////////////////////////////////////////////////////
-
-    MIL << "calling refreshMetadata" << (force_download ? ", forced" : "")
-        << endl;
-
-    error = refresh_raw_metadata(zypper, repo, force_download);
-  }
-
-  // db rebuild
-  if (!(error || zypper.cOpts().count("download-only")))
-  {
-    bool force_build =
-      zypper.cOpts().count("force") || zypper.cOpts().count("force-build");
-
-    MIL << "calling buildCache" << (force_build ? ", forced" : "") << endl;
-
-    error = build_cache(zypper, repo, force_build);
-  }
-
-  return error;
+  return refresh_repo_download(zypper, repo)
+      || refresh_repo_build(zypper, repo);
 }
 
 // ----------------------------------------------------------------------------
@@ -2796,6 +3461,11 @@ void refresh_services(Zypper & zypper)
 
   if (!specified.empty() || not_found.empty())
   {
+    // services (and plain repos) to refresh, in the original order
+    ServiceList torefresh;
+    // index services, refreshed all at once
+    list<ServiceInfo> index_services;
+
     unsigned number = 0;
     for_(sit, services.begin(), services.end())
     {
@@ -2839,12 +3509,30 @@ void refresh_services(Zypper & zypper)
         continue;
       }
 
-      // do the refresh
+      torefresh.push_back(service_ptr);
+      ServiceInfo_Ptr s = dynamic_pointer_cast<ServiceInfo>(service_ptr);
+      if (s)
+        index_services.push_back(*s);
+    }
+
+    // do the refresh
+    set<string> failed;
+    if (!index_services.empty())
+    {
+      failed = refresh_services_parallel(zypper, index_services);
+      // re-read the repos modified by the workers
+      zypper.initRepoManager();
+    }
+
+    for_(sit, torefresh.begin(), torefresh.end())
+    {
+      RepoInfoBase_Ptr service_ptr(*sit);
+
       bool error = false;
       ServiceInfo_Ptr s = dynamic_pointer_cast<ServiceInfo>(service_ptr);
       if (s)
       {
-        error = refresh_service(zypper, *s);
+        error = failed.count(s->alias());
 
         // refresh also service's repos
         if (zypper.cOpts().count("with-repos") || zypper.globalOpts().is_rug_compatible)
@@ -3182,31 +3870,101 @@ void modify_services_by_option( Zypper & zypper )
 
 void load_resolvables(Zypper & zypper)
 {
-  static bool done = false;
-  // don't call this fuction more than once for a single ZYpp instance
-  // (e.g. in shell)
-  if (done)
+  // load only what is not in the pool yet (the shell keeps the pool)
+  bool load_target = !target_resolvables_loaded
+                     && !zypper.globalOpts().disable_system_resolvables;
+  if (repo_resolvables_loaded && !load_target)
     return;
 
   MIL << "Going to load resolvables" << endl;
 
-  load_repo_resolvables(zypper);
-  if (!zypper.globalOpts().disable_system_resolvables)
+  if (!repo_resolvables_loaded)
+  {
+    load_repo_resolvables(zypper);
+    repo_resolvables_loaded = true;
+  }
+  if (load_target)
+  {
     load_target_resolvables(zypper);
+    target_resolvables_loaded = true;
+  }
 
-  done = true;
   MIL << "Done loading resolvables" << endl;
 }
 
 // ---------------------------------------------------------------------------
 
+void reset_repos(Zypper & zypper)
+{
+  MIL << "Forgetting the repos, they will be read again" << endl;
+  zypper.runtimeData().repos.clear();
+  repos_initialized = false;
+
+  if (repo_resolvables_loaded)
+  {
+    vector<Repository> loaded(sat::Pool::instance().reposBegin(),
+                              sat::Pool::instance().reposEnd());
+    for_(it, loaded.begin(), loaded.end())
+      if (!it->isSystemRepo())
+        it->eraseFromPool();
+    repo_resolvables_loaded = false;
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+void reload_target_resolvables(Zypper & zypper)
+{
+  if (!target_resolvables_loaded)
+    return;
+
+  string stamp(rpmdb_stamp(zypper.globalOpts().root_dir));
+  if (stamp == target_rpmdb_stamp)
+  {
+    DBG << "RPM database unchanged" << endl;
+    return;
+  }
+
+  MIL << "RPM database changed, reloading" << endl;
+  try
+  {
+    God->target()->reload();
+    target_rpmdb_stamp = stamp;
+  }
+  catch ( const Exception & e )
+  {
+    ZYPP_CAUGHT(e);
+    zypper.out().error(e,
+        _("Problem occured while reading the installed packages:"),
+        _("Please see the above error message for a hint."));
+  }
+}
+
+// ---------------------------------------------------------------------------
+
 void load_repo_resolvables(Zypper & zypper)
 {
   RepoManager & manager = zypper.repoManager();
   RuntimeData & gData = zypper.runtimeData();
+  ProfileScope profile("load_repo_resolvables");
 
   zypper.out().info(_("Loading repository data..."));
 
+  // read the solv files into the page cache while the previous ones
+  // are being added to the pool; not the first one, which is loaded
+  // right away and would only be read twice
+  FilePrefetcher prefetcher;
+  bool first = true;
+  for_(it, gData.repos.begin(), gData.repos.end())
+  {
+    if (!it->enabled())
+      continue;
+    if (!first)
+      prefetcher.add((zypper.globalOpts().rm_options.repoSolvCachePath
+                      / it->escaped_alias() / "solv").asString());
+    first = false;
+  }
+
   for (std::list<RepoInfo>::iterator it = gData.repos.begin();
        it !=  gData.repos.end(); ++it)
   {
@@ -3259,7 +4017,10 @@ void load_repo_resolvables(Zypper & zypper)
         }
       }
 
-      manager.loadFromCache(repo);
+      {
+        ProfileScope profile("loadFromCache", repo.alias());
+        manager.loadFromCache(repo);
+      }
 
       // check that the metadata is not outdated
       // feature #301904
@@ -3301,11 +4062,13 @@ void load_repo_resolvables(Zypper & zypper)
 
 void load_target_resolvables(Zypper & zypper)
 {
+  ProfileScope profile("load_target_resolvables");
   zypper.out().info(_("Reading installed packages..."));
   MIL << "Going to read RPM database" << endl;
 
   try
   {
+    target_rpmdb_stamp = rpmdb_stamp(zypper.globalOpts().root_dir);
     God->target()->load();
   }
   catch ( const Exception & e )
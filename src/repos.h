@@ -66,6 +66,12 @@ unsigned repo_specs_to_aliases(
  */
 void init_repos(Zypper & zypper);
 
+/**
+ * Whether the 'zypp-refresh --daemon' background refresher is running,
+ * according to its status file.
+ */
+bool refresh_daemon_running();
+
 /**
  * List defined repositories.
  */
@@ -214,6 +220,19 @@ void load_target_resolvables(Zypper & zypper);
  */
 void load_repo_resolvables(Zypper & zypper);
 
+/**
+ * Forget the repos read by init_repos() and remove their resolvables from
+ * the pool, so that the next init_repos() and load_resolvables() read them
+ * anew. To be used in the shell after commands modifying the repos.
+ */
+void reset_repos(Zypper & zypper);
+
+/**
+ * Reload the installed resolvables if they have been loaded already and
+ * the RPM database changed since then.
+ */
+void reload_target_resolvables(Zypper & zypper);
+
 
 /**
  * If ZMD process found, notify user that ZMD is running and that changes
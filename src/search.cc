@@ -1,4 +1,7 @@
 #include <iostream>
+#include <algorithm>
+
+#include <unistd.h>
 
 #include <zypp/ZYpp.h> // for zypp::ResPool::instance()
 
@@ -16,6 +19,7 @@
 
 #include "main.h"
 #include "utils/misc.h" // for kind_to_string_localized and string_patch_status
+#include "PoolSnapshot.h"
 
 #include "search.h"
 
@@ -24,12 +28,26 @@ using namespace std;
 
 extern ZYpp::Ptr God;
 
+/**
+ * Let the solver establish the status of patches (needed for the status
+ * column and for --installed-only and --uninstalled-only) if not done yet.
+ */
+static void establish_status(bool & needed)
+{
+  if (!needed)
+    return;
+  needed = false;
+  resolve_status(*Zypper::instance());
+}
+
 FillSearchTableSolvable::FillSearchTableSolvable(
     Table & table, zypp::TriBool inst_notinst)
   : _table( &table )
   , _gopts(Zypper::instance()->globalOpts())
   , _inst_notinst(inst_notinst)
   , _show_alias(Zypper::instance()->config().show_alias)
+  , _show_status(true)
+  , _establish_status(false)
 {
   Zypper & zypper = *Zypper::instance();
   if (zypper.cOpts().find("repo") != zypper.cOpts().end())
@@ -38,6 +56,8 @@ FillSearchTableSolvable::FillSearchTableSolvable(
     for_(it, repos.begin(), repos.end())
       _repos.insert(it->alias());
   }
+  if (zypper.cOpts().find("no-status") != zypper.cOpts().end())
+    _show_status = false;
 
   TableHeader header;
 
@@ -47,9 +67,10 @@ FillSearchTableSolvable::FillSearchTableSolvable(
   //
   if (_gopts.is_rug_compatible)
   {
-    header
+    if (_show_status)
       // translators: S for 'installed Status'
-      << _("S")
+      header << _("S");
+    header
       // translators: catalog (rug's word for repository) (header)
       << _("Catalog")
       // translators: Bundle is a term used in rug. See rug for how to translate it.
@@ -63,9 +84,10 @@ FillSearchTableSolvable::FillSearchTableSolvable(
   }
   else
   {
-    header
+    if (_show_status)
       // translators: S for 'installed Status'
-      << _("S")
+      header << _("S");
+    header
       // translators: name (general header)
       << _("Name")
       // translators: type (general header)
@@ -96,7 +118,9 @@ bool FillSearchTableSolvable::addPicklistItem( const ui::Selectable::constPtr &
   //   i  - exactly this version installed
   //   v  - installed, but in different version
   //      - not installed at all
-  if ( pi->isSystem() )
+  if ( ! _show_status )
+    ;	// no status column (--no-status)
+  else if ( pi->isSystem() )
   {
     // picklist: ==> not available
     if ( _inst_notinst == false )
@@ -116,6 +140,8 @@ bool FillSearchTableSolvable::addPicklistItem( const ui::Selectable::constPtr &
     }
     else
     {
+      if ( traits::isPseudoInstalled( pi->kind() ) )
+	establish_status( _establish_status );
       bool identicalInstalledToo = ( traits::isPseudoInstalled( pi->kind() )
 				   ? ( pi.isSatisfied() )
 				   : ( sel->identicalInstalled( pi ) ) );
@@ -172,7 +198,7 @@ bool FillSearchTableSolvable::operator()( const zypp::PoolQuery::const_iterator
 
   // after addPicklistItem( const ui::Selectable::constPtr & sel, const PoolItem & pi ) is
   // done, add the details about matches to last row
-  TableRow & lastRow = _table->rows().back();
+  Table & table( *_table );
 
   // don't show details for patterns with user visible flag not set (bnc #538152)
   if (it->kind() == zypp::ResKind::pattern)
@@ -194,13 +220,13 @@ bool FillSearchTableSolvable::operator()( const zypp::PoolQuery::const_iterator
            match->inSolvAttr() == zypp::sat::SolvAttr::description )
       {
 	// multiline matchstring
-        lastRow.addDetail( attrib + ":" );
-        lastRow.addDetail( match->asString() );
+        table.addDetail( attrib + ":" );
+        table.addDetail( match->asString() );
       }
       else
       {
         // print attribute and match in one line, e.g. requires: libzypp >= 11.6.2
-        lastRow.addDetail( attrib + ": " + match->asString() );
+        table.addDetail( attrib + ": " + match->asString() );
       }
     }
   }
@@ -234,6 +260,8 @@ FillSearchTableSelectable::FillSearchTableSelectable(
   : _table( &table )
   , _gopts(Zypper::instance()->globalOpts())
   , inst_notinst(installed_only)
+  , _show_status(true)
+  , _establish_status(false)
 {
   Zypper & zypper = *Zypper::instance();
   if (zypper.cOpts().find("repo") != zypper.cOpts().end())
@@ -242,14 +270,17 @@ FillSearchTableSelectable::FillSearchTableSelectable(
     for_(it, repos.begin(), repos.end())
       _repos.insert(it->alias());
   }
+  if (zypper.cOpts().find("no-status") != zypper.cOpts().end())
+    _show_status = false;
 
   TableHeader header;
   //
   // *** CAUTION: It's a mess, but adding/changing colums here requires
   //              adapting OutXML::searchResult !
   //
-  // translators: S for installed Status
-  header << _("S");
+  if (_show_status)
+    // translators: S for installed Status
+    header << _("S");
   header << _("Name");
   // translators: package summary (header)
   header << _("Summary");
@@ -272,8 +303,13 @@ bool FillSearchTableSelectable::operator()(const zypp::ui::Selectable::constPtr
   // whether to show the solvable as 'installed'
   bool installed = false;
 
-  if (zypp::traits::isPseudoInstalled(s->kind()))
+  if (!_show_status)
+    ; // no status column (--no-status)
+  else if (zypp::traits::isPseudoInstalled(s->kind()))
+  {
+    establish_status(_establish_status);
     installed = s->theObj().isSatisfied();
+  }
   // check for installed counterpart in one of specified repos (bnc #467106)
   else if (!_repos.empty())
   {
@@ -292,7 +328,9 @@ bool FillSearchTableSelectable::operator()(const zypp::ui::Selectable::constPtr
     installed = !s->installedEmpty();
 
 
-  if (s->kind() != zypp::ResKind::srcpackage)
+  if (!_show_status)
+    ; // no status column (--no-status)
+  else if (s->kind() != zypp::ResKind::srcpackage)
   {
     if (installed)
     {
@@ -560,6 +598,7 @@ void list_packages(Zypper & zypper)
 
   bool installed_only = zypper.cOpts().count("installed-only");
   bool notinst_only = zypper.cOpts().count("uninstalled-only");
+  bool by_repo = zypper.cOpts().count("sort-by-repo") || zypper.cOpts().count("sort-by-catalog");
   bool check = false;
 
   if ( zypper.cOpts().count("orphaned") || zypper.cOpts().count("suggested") ||
@@ -569,10 +608,19 @@ void list_packages(Zypper & zypper)
     God->resolver()->resolvePool();
   }
 
-  ResPoolProxy::const_iterator
-    it = God->pool().proxy().byKindBegin(ResKind::package),
-    e  = God->pool().proxy().byKindEnd(ResKind::package);
-  for (; it != e; ++it )
+  // Add the rows sorted by name already (the final sort is stable) so that
+  // they can be printed right away if the output goes to another program.
+  vector<ui::Selectable::constPtr> sels(
+    God->pool().proxy().byKindBegin(ResKind::package),
+    God->pool().proxy().byKindEnd(ResKind::package));
+  if (!by_repo)
+  {
+    stable_sort(sels.begin(), sels.end(), SelectableNameLess());
+    if (!::isatty(STDOUT_FILENO))
+      tbl.stream(cout);
+  }
+
+  for_(it, sels.begin(), sels.end())
   {
     ui::Selectable::constPtr s = *it;
     bool found = false;
@@ -639,7 +687,7 @@ void list_packages(Zypper & zypper)
       tbl << row;
     }
   }
-  if (zypper.cOpts().count("sort-by-repo") || zypper.cOpts().count("sort-by-catalog"))
+  if (by_repo)
     tbl.sort(1); // Repo
   else
     tbl.sort(2); // Name
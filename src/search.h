@@ -28,6 +28,13 @@ struct FillSearchTableSolvable
   std::set<std::string> _repos;
   zypp::TriBool _inst_notinst;
   bool _show_alias;
+  /** Whether to show the status column (not with --no-status) */
+  bool _show_status;
+  /**
+   * Whether the status of patches still needs to be established by the
+   * solver. If set, the solver runs when the first patch is added.
+   */
+  mutable bool _establish_status;
 
   FillSearchTableSolvable(
       Table & table,
@@ -59,6 +66,10 @@ struct FillSearchTableSelectable
   /** Aliases of repos specified as --repo */
   std::set<std::string> _repos;
   zypp::TriBool inst_notinst;
+  /** Whether to show the status column (not with --no-status) */
+  bool _show_status;
+  /** \see FillSearchTableSolvable::_establish_status */
+  mutable bool _establish_status;
 
   FillSearchTableSelectable(
       Table & table, zypp::TriBool installed_only = zypp::indeterminate);
@@ -84,6 +95,17 @@ struct FillPatchesTable
   bool operator()(const zypp::PoolItem & pi) const;
 };
 
+/**
+ * Orders selectables by name, the way \ref Table::sort() orders the rows
+ * by the name column. Lets the listings add their rows sorted already so
+ * that the table can be printed while it is filled (\ref Table::stream()).
+ */
+struct SelectableNameLess
+{
+  bool operator()(const zypp::ui::Selectable::constPtr & a,
+                  const zypp::ui::Selectable::constPtr & b) const
+  { return a->name() < b->name(); }
+};
 
 /** List all patches with specific info in specified repos */
 void list_patches(Zypper & zypper);
@@ -23,6 +23,7 @@
 #include "utils/misc.h"
 #include "utils/prompt.h"      // Continue? and solver problem prompt
 #include "utils/pager.h"       // to view the summary
+#include "utils/Profiler.h"
 #include "Summary.h"
 
 #include "solve-commit.h"
@@ -305,7 +306,7 @@ static void set_ignore_recommends_of_installed(Zypper & zypper)
 }
 
 
-static void set_solver_flags(Zypper & zypper)
+void set_solver_flags(Zypper & zypper)
 {
   set_force_resolution(zypper);
   set_clean_deps(zypper);
@@ -321,6 +322,7 @@ static void set_solver_flags(Zypper & zypper)
  */
 bool resolve(Zypper & zypper)
 {
+  ProfileScope profile("resolve");
   dump_pool(); // debug
   set_solver_flags(zypper);
   DBG << "Calling the solver..." << endl;
@@ -18,6 +18,11 @@
 #include "Zypper.h"
 
 
+/**
+ * Set the solver flags according to the command, its options and zypper.conf.
+ */
+void set_solver_flags(Zypper & zypper);
+
 /**
  * Run the solver.
  * 
@@ -0,0 +1,318 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <zypp/base/Easy.h>
+#include <zypp/base/Logger.h>
+#include <zypp/Pathname.h>
+#include <zypp/PathInfo.h>
+
+#include "utils/Augeas.h"
+#include "utils/misc.h"
+#include "utils/ConfigCache.h"
+
+using namespace std;
+using namespace zypp;
+
+// libzypp logger settings
+#undef  ZYPP_BASE_LOGGER_LOGGROUP
+#define ZYPP_BASE_LOGGER_LOGGROUP "zypper"
+
+// ---------------------------------------------------------------------------
+
+namespace
+{
+  const char CACHE_MAGIC[8] = { 'Z', 'Y', 'P', 'P', 'C', 'O', 'N', 'F' };
+  const uint32_t CACHE_VERSION = 1;
+
+  /** The Augeas lens the values are parsed with (see Augeas::Augeas()). */
+  const char * ZYPPER_LENS = "/usr/share/zypper/zypper.aug";
+
+  /** The cache file, empty if we don't know where to put it. */
+  string cache_file()
+  {
+    string dir(user_cache_dir());
+    return dir.empty() ? dir : dir + "/zypper.conf.cache";
+  }
+
+  void put(string & buf, uint64_t value)
+  { buf.append(reinterpret_cast<const char *>(&value), sizeof(value)); }
+
+  void put(string & buf, const string & value)
+  {
+    put(buf, (uint64_t) value.size());
+    buf.append(value);
+  }
+
+  /** Reads back what \ref put() wrote, failing on truncated data. */
+  class Reader
+  {
+  public:
+    Reader(const string & buf) : _buf(buf), _pos(0), _ok(true) {}
+
+    uint64_t u64()
+    {
+      uint64_t value = 0;
+      if (_pos + sizeof(value) > _buf.size())
+        _ok = false;
+      else
+      {
+        ::memcpy(&value, _buf.data() + _pos, sizeof(value));
+        _pos += sizeof(value);
+      }
+      return value;
+    }
+
+    string str()
+    {
+      uint64_t size = u64();
+      if (!_ok || size > _buf.size() - _pos)
+      {
+        _ok = false;
+        return string();
+      }
+      string value(_buf, _pos, size);
+      _pos += size;
+      return value;
+    }
+
+    bool ok() const
+    { return _ok; }
+
+  private:
+    const string & _buf;
+    string::size_type _pos;
+    bool _ok;
+  };
+} // namespace
+
+// ---------------------------------------------------------------------------
+
+bool ConfigCache::Source::operator==(const Source & other) const
+{
+  return path == other.path
+      && exists == other.exists
+      && dev == other.dev
+      && ino == other.ino
+      && size == other.size
+      && mtime_sec == other.mtime_sec
+      && mtime_nsec == other.mtime_nsec;
+}
+
+ConfigCache::Source ConfigCache::stat(const string & path)
+{
+  Source source;
+  source.path = path;
+  source.exists = false;
+  source.dev = source.ino = source.size = source.mtime_sec = source.mtime_nsec = 0;
+
+  struct ::stat st;
+  if (::stat(path.c_str(), &st) == 0)
+  {
+    source.exists = true;
+    source.dev = st.st_dev;
+    source.ino = st.st_ino;
+    source.size = st.st_size;
+    source.mtime_sec = st.st_mtim.tv_sec;
+    source.mtime_nsec = st.st_mtim.tv_nsec;
+  }
+  return source;
+}
+
+// ---------------------------------------------------------------------------
+
+ConfigCache::ConfigCache(const string & file, const vector<string> & options)
+  : _cachefile(cache_file())
+  , _cached(false)
+{
+  // the same files Augeas reads
+  _sources.push_back(stat(ZYPPER_LENS));
+  Pathname filepath(file);
+  if (!file.empty() && PathInfo(filepath).isExist())
+  {
+    if (filepath.relative())
+    {
+      const char * env = ::getenv("PWD");
+      string wd = env ? env : ".";
+      filepath = wd / filepath;
+    }
+    _sources.push_back(stat(filepath.asString()));
+  }
+  else
+  {
+    _sources.push_back(stat("/etc/zypp/zypper.conf"));
+    const char * env = ::getenv("HOME");
+    if (env && *env)
+      _sources.push_back(stat(string(env) + "/.zypper.conf"));
+  }
+
+  if (load(options))
+  {
+    _cached = true;
+    MIL << "Got the config from " << _cachefile << endl;
+    return;
+  }
+
+  Augeas augeas(file);
+  for_(it, options.begin(), options.end())
+    _values[*it] = augeas.getOption(*it);
+
+  store();
+}
+
+string ConfigCache::getOption(const string & option) const
+{
+  map<string, string>::const_iterator it = _values.find(option);
+  if (it == _values.end())
+  {
+    ERR << "invalid option " << option << endl;
+    return string();
+  }
+  return it->second;
+}
+
+// ---------------------------------------------------------------------------
+
+bool ConfigCache::load(const vector<string> & options)
+{
+  if (_cachefile.empty())
+    return false;
+
+  string buf;
+  {
+    ifstream in(_cachefile.c_str(), ios::binary);
+    if (!in)
+      return false;
+    ostringstream content;
+    content << in.rdbuf();
+    buf = content.str();
+  }
+
+  if (buf.size() < sizeof(CACHE_MAGIC)
+      || ::memcmp(buf.data(), CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0)
+  {
+    WAR << _cachefile << " is not a zypper config cache" << endl;
+    return false;
+  }
+  buf.erase(0, sizeof(CACHE_MAGIC));
+
+  Reader reader(buf);
+  if (reader.u64() != CACHE_VERSION)
+    return false;
+
+  // the config files must not have changed since
+  uint64_t count = reader.u64();
+  if (!reader.ok() || count != _sources.size())
+  {
+    DBG << "config files differ" << endl;
+    return false;
+  }
+  for_(it, _sources.begin(), _sources.end())
+  {
+    Source source;
+    source.path = reader.str();
+    source.exists = reader.u64();
+    source.dev = reader.u64();
+    source.ino = reader.u64();
+    source.size = reader.u64();
+    source.mtime_sec = reader.u64();
+    source.mtime_nsec = reader.u64();
+    if (!reader.ok() || !(source == *it))
+    {
+      DBG << it->path << " changed" << endl;
+      return false;
+    }
+  }
+
+  map<string, string> values;
+  count = reader.u64();
+  for (uint64_t i = 0; reader.ok() && i < count; ++i)
+  {
+    string option = reader.str();
+    values[option] = reader.str();
+  }
+  if (!reader.ok())
+  {
+    WAR << _cachefile << " is truncated" << endl;
+    return false;
+  }
+
+  // options added since the cache was written
+  for_(it, options.begin(), options.end())
+    if (values.find(*it) == values.end())
+    {
+      DBG << "option " << *it << " is not in the cache" << endl;
+      return false;
+    }
+
+  _values.swap(values);
+  return true;
+}
+
+void ConfigCache::store() const
+{
+  if (_cachefile.empty())
+    return;
+
+  string buf(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  put(buf, CACHE_VERSION);
+  put(buf, _sources.size());
+  for_(it, _sources.begin(), _sources.end())
+  {
+    put(buf, it->path);
+    put(buf, it->exists);
+    put(buf, it->dev);
+    put(buf, it->ino);
+    put(buf, it->size);
+    put(buf, it->mtime_sec);
+    put(buf, it->mtime_nsec);
+  }
+  put(buf, _values.size());
+  for_(it, _values.begin(), _values.end())
+  {
+    put(buf, it->first);
+    put(buf, it->second);
+  }
+
+  // don't leave files of root in the home of a user (sudo keeps $HOME)
+  Pathname dir(Pathname(_cachefile).dirname());
+  if (!assert_own_dir(dir))
+  {
+    DBG << "not writing the config cache to " << dir << endl;
+    return;
+  }
+
+  string tmpfile(_cachefile + ".new");
+  {
+    ofstream out(tmpfile.c_str(), ios::binary | ios::trunc);
+    out.write(buf.data(), buf.size());
+    if (!out)
+    {
+      WAR << "Could not write " << tmpfile << endl;
+      ::unlink(tmpfile.c_str());
+      return;
+    }
+  }
+  if (::rename(tmpfile.c_str(), _cachefile.c_str()) != 0)
+  {
+    WAR << "Could not rename " << tmpfile << ": " << ::strerror(errno) << endl;
+    ::unlink(tmpfile.c_str());
+    return;
+  }
+  MIL << "wrote the config cache " << _cachefile << endl;
+}
@@ -0,0 +1,73 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#ifndef ZYPPER_UTILS_CONFIGCACHE_H_
+#define ZYPPER_UTILS_CONFIGCACHE_H_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <zypp/base/NonCopyable.h>
+
+/**
+ * The option values resolved from the zypper.conf files, kept in a compact
+ * binary file in the user's cache directory ($XDG_CACHE_HOME/zypper or
+ * ~/.cache/zypper).
+ *
+ * Initializing Augeas and loading its lens costs more than the rest of a
+ * simple zypper run, so Augeas is used only if any of the config files (or
+ * the lens) changed since the cache was written, as told by their inode,
+ * size and mtime. Then the cache is written anew.
+ */
+class ConfigCache : private zypp::base::NonCopyable
+{
+public:
+  /**
+   * Get the values of \a options from the cache, or from Augeas.
+   *
+   * \param file     custom config file, or empty for the default ones
+   * \param options  all the known options (section/name)
+   * \throws zypp::Exception if the config files can't be parsed
+   */
+  ConfigCache(const std::string & file, const std::vector<std::string> & options);
+
+  /** The value of \a option, empty if not set. Like Augeas::getOption(). */
+  std::string getOption(const std::string & option) const;
+
+  /** Whether the values were taken from the cache. */
+  bool cached() const
+  { return _cached; }
+
+private:
+  /** A source file of the values, as it was when they were read. */
+  struct Source
+  {
+    std::string path;
+    bool exists;
+    unsigned long long dev;
+    unsigned long long ino;
+    unsigned long long size;
+    unsigned long long mtime_sec;
+    unsigned long long mtime_nsec;
+
+    bool operator==(const Source & other) const;
+  };
+
+  static Source stat(const std::string & path);
+
+  bool load(const std::vector<std::string> & options);
+  void store() const;
+
+private:
+  std::string _cachefile;
+  std::vector<Source> _sources;
+  std::map<std::string, std::string> _values;
+  bool _cached;
+};
+
+#endif /* ZYPPER_UTILS_CONFIGCACHE_H_ */
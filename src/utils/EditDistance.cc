@@ -0,0 +1,73 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <vector>
+#include <cstring>
+
+#include "utils/EditDistance.h"
+
+using namespace std;
+
+// ---------------------------------------------------------------------------
+
+EditDistance::EditDistance(const string & pattern)
+  : _pattern(pattern)
+{
+  ::memset(_peq, 0, sizeof(_peq));
+  if (_pattern.size() <= 64)
+    for (unsigned i = 0; i < _pattern.size(); ++i)
+      _peq[(unsigned char) _pattern[i]] |= uint64_t(1) << i;
+}
+
+unsigned EditDistance::operator()(const string & text) const
+{
+  unsigned m = _pattern.size();
+  if (m == 0)
+    return text.size();
+  if (m > 64)
+    return matrix(text);
+
+  uint64_t pv = ~uint64_t(0);
+  uint64_t mv = 0;
+  uint64_t last = uint64_t(1) << (m - 1);
+  unsigned score = m;
+  for (string::const_iterator it = text.begin(); it != text.end(); ++it)
+  {
+    uint64_t eq = _peq[(unsigned char) *it];
+    uint64_t xv = eq | mv;
+    uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+    uint64_t ph = mv | ~(xh | pv);
+    uint64_t mh = pv & xh;
+    if (ph & last)
+      ++score;
+    else if (mh & last)
+      --score;
+    ph = (ph << 1) | 1;
+    mh <<= 1;
+    pv = mh | ~(xv | ph);
+    mv = ph & xv;
+  }
+  return score;
+}
+
+unsigned EditDistance::matrix(const string & text) const
+{
+  vector<unsigned> prev(text.size() + 1);
+  vector<unsigned> cur(text.size() + 1);
+  for (unsigned j = 0; j <= text.size(); ++j)
+    prev[j] = j;
+  for (unsigned i = 1; i <= _pattern.size(); ++i)
+  {
+    cur[0] = i;
+    for (unsigned j = 1; j <= text.size(); ++j)
+      cur[j] = min(min(prev[j] + 1, cur[j - 1] + 1),
+                   prev[j - 1] + (_pattern[i - 1] != text[j - 1]));
+    prev.swap(cur);
+  }
+  return prev[text.size()];
+}
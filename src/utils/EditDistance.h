@@ -0,0 +1,37 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#ifndef ZYPPER_UTILS_EDITDISTANCE_H_
+#define ZYPPER_UTILS_EDITDISTANCE_H_
+
+#include <string>
+
+#include <stdint.h>
+
+/**
+ * Levenshtein distance of a fixed pattern to other strings, in bytes.
+ * Patterns of up to 64 bytes use the bit-vector algorithm of Myers (as
+ * formulated by Hyyrö), computing a whole column of the distance matrix
+ * with a few operations on machine words. Longer ones use the plain matrix.
+ */
+class EditDistance
+{
+public:
+  EditDistance(const std::string & pattern);
+
+  /** The distance of \a text to the pattern. */
+  unsigned operator()(const std::string & text) const;
+
+private:
+  unsigned matrix(const std::string & text) const;
+
+  std::string _pattern;
+  /** bit i set in _peq[c] if _pattern[i] == c */
+  uint64_t _peq[256];
+};
+
+#endif /* ZYPPER_UTILS_EDITDISTANCE_H_ */
@@ -0,0 +1,109 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <zypp/base/Logger.h>
+
+#include "utils/FilePrefetcher.h"
+
+using namespace std;
+
+// libzypp logger settings
+#undef  ZYPP_BASE_LOGGER_LOGGROUP
+#define ZYPP_BASE_LOGGER_LOGGROUP "zypper"
+
+// ---------------------------------------------------------------------------
+
+FilePrefetcher::FilePrefetcher(unsigned threads)
+  : _stop(false)
+{
+  try
+  {
+    for (unsigned i = 0; i < threads; ++i)
+      _threads.push_back(thread(&FilePrefetcher::run, this));
+  }
+  catch (const system_error & e)
+  {
+    // not fatal, add() does nothing then
+    WAR << "Could not start prefetch threads: " << e.what() << endl;
+  }
+}
+
+FilePrefetcher::~FilePrefetcher()
+{
+  {
+    lock_guard<mutex> lock(_mutex);
+    _queue.clear();
+    _stop = true;
+  }
+  _cond.notify_all();
+
+  for (vector<thread>::iterator it = _threads.begin(); it != _threads.end(); ++it)
+    it->join();
+}
+
+// ---------------------------------------------------------------------------
+
+void FilePrefetcher::add(const string & path)
+{
+  if (_threads.empty())
+    return;
+
+  {
+    lock_guard<mutex> lock(_mutex);
+    _queue.push_back(path);
+  }
+  _cond.notify_one();
+}
+
+// ---------------------------------------------------------------------------
+
+void FilePrefetcher::run()
+{
+  for (;;)
+  {
+    string path;
+    {
+      unique_lock<mutex> lock(_mutex);
+      while (!_stop && _queue.empty())
+        _cond.wait(lock);
+      if (_stop)
+        return;
+      path = _queue.front();
+      _queue.pop_front();
+    }
+    prefetch(path);
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+void FilePrefetcher::prefetch(const string & path)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+
+  struct stat st;
+  if (::fstat(fd, &st) == 0 && st.st_size > 0)
+  {
+    // readahead() only queues the reads and may return before the data
+    // are in the page cache (or before all of them are even requested),
+    // which is fine for a hint; fall back to reading the file where it is
+    // not supported
+    if (::readahead(fd, 0, st.st_size) != 0)
+    {
+      char buf[65536];
+      while (::read(fd, buf, sizeof(buf)) > 0)
+        ;
+    }
+  }
+  ::close(fd);
+}
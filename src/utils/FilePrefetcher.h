@@ -0,0 +1,56 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#ifndef ZYPPER_UTILS_FILEPREFETCHER_H_
+#define ZYPPER_UTILS_FILEPREFETCHER_H_
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <zypp/base/NonCopyable.h>
+
+/**
+ * Reads files into the page cache on helper threads, so that reading them
+ * later (e.g. loading solv files into the pool) does not block on disk or
+ * network I/O.
+ *
+ * Files are prefetched in the order they were \ref add()ed. The helper
+ * threads do plain system calls only, they never touch libzypp, which is
+ * not thread safe.
+ */
+class FilePrefetcher : private zypp::base::NonCopyable
+{
+public:
+  FilePrefetcher(unsigned threads = 2);
+  /** Drops the files not prefetched yet and waits for the helper threads. */
+  ~FilePrefetcher();
+
+  /** Queue \a path for prefetching. Nonexistent files are ignored. */
+  void add(const std::string & path);
+
+  /**
+   * Start reading \a path into the page cache. Returns once the reads are
+   * queued, not necessarily done, where readahead() is supported.
+   */
+  static void prefetch(const std::string & path);
+
+private:
+  void run();
+
+private:
+  std::deque<std::string> _queue;
+  std::vector<std::thread> _threads;
+  std::mutex _mutex;
+  std::condition_variable _cond;
+  bool _stop;
+};
+
+#endif /* ZYPPER_UTILS_FILEPREFETCHER_H_ */
@@ -0,0 +1,304 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#include <zypp/base/Easy.h>
+#include <zypp/base/Logger.h>
+#include <zypp/base/Exception.h>
+
+#include "utils/ProcessPool.h"
+
+using namespace std;
+
+// libzypp logger settings
+#undef  ZYPP_BASE_LOGGER_LOGGROUP
+#define ZYPP_BASE_LOGGER_LOGGROUP "zypper"
+
+// how long to sleep between checks for finished children
+#define POLL_INTERVAL_US 20000
+
+/** Monotonic time in seconds. */
+static double now()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** Read the whole \a file into \a str and close it. */
+static void readAll(FILE * file, string & str)
+{
+  ::rewind(file);
+  char buf[4096];
+  size_t n;
+  while ((n = ::fread(buf, 1, sizeof(buf), file)) > 0)
+    str.append(buf, n);
+  ::fclose(file);
+}
+
+/** Called by job_signal_handler(), see ProcessPool::setStopRequest(). */
+static void (*stop_request)() = NULL;
+static volatile sig_atomic_t job_signalled = 0;
+
+/**
+ * SIGINT and SIGTERM handler of the jobs. The handler of the parent must
+ * not run in them: it may clean up and exit(), running the static
+ * destructors which release what the parent owns (e.g. the ZYpp lock).
+ */
+static void job_signal_handler(int sig)
+{
+  if (job_signalled || !stop_request)
+    ::_exit(128 + sig);
+  job_signalled = 1;
+  stop_request();
+}
+
+// ---------------------------------------------------------------------------
+
+FILE * ProcessPool::_job_data = NULL;
+
+void ProcessPool::setStopRequest(void (*request)())
+{ stop_request = request; }
+
+ProcessPool::ProcessPool(unsigned max_jobs)
+  : _max_jobs(max_jobs ? max_jobs : 1)
+  , _running(0)
+{}
+
+ProcessPool::~ProcessPool()
+{
+  if (_running)
+  {
+    WAR << "Killing " << _running << " unfinished jobs." << endl;
+    killAll();
+  }
+
+  for_(it, _jobs.begin(), _jobs.end())
+  {
+    if (it->capture)
+      ::fclose(it->capture);
+    if (it->data)
+      ::fclose(it->data);
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+unsigned ProcessPool::start(const Job & job, unsigned timeout, unsigned grace)
+{
+  while (_running >= _max_jobs)
+    waitAny();
+
+  Child child;
+  child.capture = ::tmpfile();
+  if (!child.capture)
+    ZYPP_THROW(zypp::Exception(string("tmpfile() failed: ") + ::strerror(errno)));
+  child.data = ::tmpfile();
+  if (!child.data)
+  {
+    ::fclose(child.capture);
+    ZYPP_THROW(zypp::Exception(string("tmpfile() failed: ") + ::strerror(errno)));
+  }
+  if (timeout)
+    child.deadline = ::time(NULL) + timeout;
+  child.grace = grace;
+
+  // don't let the child inherit (and print once more) our buffered output
+  cout << flush;
+  cerr << flush;
+  ::fflush(NULL);
+
+  child.pid = ::fork();
+  if (child.pid < 0)
+  {
+    ::fclose(child.capture);
+    ::fclose(child.data);
+    ZYPP_THROW(zypp::Exception(string("fork() failed: ") + ::strerror(errno)));
+  }
+
+  if (child.pid == 0)
+  {
+    // child: capture stdout and stderr, run the job, leave without cleanup
+    ::signal(SIGINT, job_signal_handler);
+    ::signal(SIGTERM, job_signal_handler);
+    int fd = ::fileno(child.capture);
+    ::dup2(fd, STDOUT_FILENO);
+    ::dup2(fd, STDERR_FILENO);
+    // jobs must not prompt; let them see EOF on any attempt to read input
+    int nullfd = ::open("/dev/null", O_RDONLY);
+    if (nullfd >= 0)
+    {
+      ::dup2(nullfd, STDIN_FILENO);
+      ::close(nullfd);
+    }
+
+    _job_data = child.data;
+
+    int ret = 255;
+    try
+    {
+      ret = job();
+    }
+    catch (const zypp::Exception & e)
+    {
+      ZYPP_CAUGHT(e);
+      cerr << e.asUserHistory() << endl;
+    }
+    catch (...)
+    {
+      ERR << "Unexpected exception in a pool job." << endl;
+    }
+
+    cout << flush;
+    cerr << flush;
+    ::fflush(NULL);
+    ::_exit(ret & 0xff);
+  }
+
+  child.started = now();
+  DBG << "started job #" << _jobs.size() << ", pid " << child.pid << endl;
+
+  _jobs.push_back(child);
+  ++_running;
+  return _jobs.size() - 1;
+}
+
+// ---------------------------------------------------------------------------
+
+bool ProcessPool::finished(unsigned id) const
+{
+  return id < _jobs.size() && _jobs[id].done;
+}
+
+// ---------------------------------------------------------------------------
+
+const ProcessPool::Result & ProcessPool::wait(unsigned id)
+{
+  while (!_jobs[id].done)
+    waitAny();
+  return _jobs[id].result;
+}
+
+// ---------------------------------------------------------------------------
+
+unsigned ProcessPool::waitAny()
+{
+  while (_running)
+  {
+    unsigned id = reap();
+    if (id != npos)
+      return id;
+    ::usleep(POLL_INTERVAL_US);
+  }
+  return npos;
+}
+
+// ---------------------------------------------------------------------------
+
+void ProcessPool::killAll(unsigned grace)
+{
+  time_t kill_time = ::time(NULL) + grace;
+  for_(it, _jobs.begin(), _jobs.end())
+  {
+    if (it->done || it->result.timedout)
+      continue;
+
+    ::kill(it->pid, SIGTERM);
+    it->result.timedout = true;
+    it->deadline = kill_time;
+  }
+
+  // reap() kills those still running after the grace period
+  while (_running)
+    if (reap() == npos)
+      ::usleep(POLL_INTERVAL_US);
+}
+
+// ---------------------------------------------------------------------------
+
+void ProcessPool::jobData(const string & data)
+{
+  if (!_job_data)
+  {
+    ERR << "jobData() called outside of a job." << endl;
+    return;
+  }
+  ::fwrite(data.data(), 1, data.size(), _job_data);
+}
+
+// ---------------------------------------------------------------------------
+
+unsigned ProcessPool::reap()
+{
+  unsigned ret = npos;
+  time_t now = ::time(NULL);
+
+  for (unsigned id = 0; id < _jobs.size(); ++id)
+  {
+    Child & child(_jobs[id]);
+    if (child.done)
+      continue;
+
+    int wstatus = 0;
+    pid_t pid = ::waitpid(child.pid, &wstatus, WNOHANG);
+    if (pid == 0 && child.deadline && now >= child.deadline)
+    {
+      // SIGTERM makes zypper in the job request exit, so that it aborts the
+      // download in progress but finishes writing any file it has begun to
+      if (!child.result.timedout)
+      {
+        WAR << "job #" << id << " (pid " << child.pid << ") timed out, terminating it." << endl;
+        ::kill(child.pid, SIGTERM);
+        child.result.timedout = true;
+        child.deadline = now + child.grace;
+      }
+      else
+      {
+        WAR << "job #" << id << " (pid " << child.pid << ") did not exit, killing it." << endl;
+        ::kill(child.pid, SIGKILL);
+        pid = ::waitpid(child.pid, &wstatus, 0);
+      }
+    }
+
+    if (pid == child.pid || (pid < 0 && errno == ECHILD))
+    {
+      collect(child, wstatus);
+      if (ret == npos)
+        ret = id;
+    }
+  }
+
+  return ret;
+}
+
+// ---------------------------------------------------------------------------
+
+void ProcessPool::collect(Child & child, int wstatus)
+{
+  if (!child.result.timedout && WIFEXITED(wstatus))
+    child.result.status = WEXITSTATUS(wstatus);
+  child.result.seconds = now() - child.started;
+
+  readAll(child.capture, child.result.output);
+  child.capture = NULL;
+  readAll(child.data, child.result.data);
+  child.data = NULL;
+
+  child.done = true;
+  --_running;
+
+  DBG << "job (pid " << child.pid << ") finished, status " << child.result.status
+      << (child.result.timedout ? " (timed out)" : "") << endl;
+}
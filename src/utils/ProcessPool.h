@@ -0,0 +1,149 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#ifndef ZYPPER_UTILS_PROCESSPOOL_H_
+#define ZYPPER_UTILS_PROCESSPOOL_H_
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <sys/types.h>
+
+#include <zypp/base/NonCopyable.h>
+
+/**
+ * Runs jobs in forked child processes, at most \ref maxJobs() at a time.
+ *
+ * libzypp is not thread safe (RepoManager, MediaManager and the callback
+ * receivers are all process global), so parallel work is done in separate
+ * processes. Each child inherits the fully initialized Zypper and ZYpp
+ * instances (including the ZYpp lock) and leaves via ::_exit(), so that
+ * no static destructor (e.g. the one releasing the lock) runs in it.
+ *
+ * Standard output and error of every job are captured in a temporary file,
+ * so that the caller can replay them in a stable order, no matter in which
+ * order the jobs actually finish.
+ */
+class ProcessPool : private zypp::base::NonCopyable
+{
+public:
+  /** The job to run in the child. The return value becomes its exit status. */
+  typedef std::function<int()> Job;
+
+  static const unsigned npos = unsigned(-1);
+  /** Default seconds a job may take to exit after SIGTERM before SIGKILL. */
+  static const unsigned kill_grace = 10;
+
+  struct Result
+  {
+    Result() : status(-1), timedout(false), seconds(0) {}
+
+    /** Exit status of the job, -1 if it did not exit normally. */
+    int status;
+    /** Whether the job was stopped because it exceeded its time limit. */
+    bool timedout;
+    /** Wall time the job took, in seconds. */
+    double seconds;
+    /** Captured standard output and error. */
+    std::string output;
+    /** Data passed by the job via \ref jobData(). */
+    std::string data;
+  };
+
+public:
+  ProcessPool(unsigned max_jobs);
+  /** Stops and reaps any jobs still running, see \ref killAll(). */
+  ~ProcessPool();
+
+  unsigned maxJobs() const { return _max_jobs; }
+
+  /** Number of jobs currently running. */
+  unsigned running() const { return _running; }
+
+  /**
+   * Start \a job in a new child process, waiting for a free slot first
+   * if \ref maxJobs() jobs are already running.
+   *
+   * \param job     the job to run
+   * \param timeout stop the job after this many seconds (0 = no limit):
+   *                send it SIGTERM, and SIGKILL if it is still running
+   *                \a grace seconds later (so a hard limit of timeout +
+   *                grace seconds)
+   * \return id of the job (ids are assigned sequentially starting at 0)
+   */
+  unsigned start(const Job & job, unsigned timeout = 0, unsigned grace = kill_grace);
+
+  /** Whether job \a id has already finished (and has been reaped). */
+  bool finished(unsigned id) const;
+
+  /** Wait for job \a id to finish and return its result. */
+  const Result & wait(unsigned id);
+
+  /**
+   * Wait for any running job to finish.
+   * \return id of the finished job or \ref npos if nothing was running.
+   */
+  unsigned waitAny();
+
+  /** Result of job \a id. Meaningful only if \ref finished(). */
+  const Result & result(unsigned id) const
+  { return _jobs[id].result; }
+
+  /**
+   * Stop all running jobs like those exceeding their time limit, with SIGKILL
+   * \a grace seconds after SIGTERM, mark them as timed out and wait for them.
+   */
+  void killAll(unsigned grace = kill_grace);
+
+  /**
+   * Pass \a data to the parent as part of the job's \ref Result, apart from
+   * the captured output. To be called from within a running job only, can
+   * be called repeatedly (the data are appended).
+   */
+  static void jobData(const std::string & data);
+
+  /**
+   * Call \a request in a job on its first SIGINT or SIGTERM, to make it
+   * stop soon, e.g. by requesting exit. It runs in a signal handler, so it
+   * should just set a flag. Another signal, or any signal if no \a request
+   * is set, ends the job via ::_exit() right away.
+   */
+  static void setStopRequest(void (*request)());
+
+private:
+  struct Child
+  {
+    Child() : pid(-1), deadline(0), grace(0), started(0), capture(NULL), data(NULL), done(false) {}
+    pid_t pid;
+    /** SIGTERM at this time, SIGKILL after another \a grace seconds */
+    time_t deadline;
+    unsigned grace;
+    double started;
+    FILE * capture;
+    FILE * data;
+    bool done;
+    Result result;
+  };
+
+  /** Reap finished children, stop those over their deadline.
+   * \return id of a job reaped in this call or \ref npos */
+  unsigned reap();
+  void collect(Child & child, int wstatus);
+
+private:
+  unsigned _max_jobs;
+  unsigned _running;
+  std::vector<Child> _jobs;
+
+  /** The data file of the job running in this (child) process. */
+  static FILE * _job_data;
+};
+
+#endif /* ZYPPER_UTILS_PROCESSPOOL_H_ */
@@ -0,0 +1,144 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <fstream>
+#include <ctime>
+
+#include <unistd.h>
+#include <malloc.h>
+#include <sys/resource.h>
+
+#include <zypp/base/Easy.h>
+#include <zypp/base/Logger.h>
+#include <zypp/base/String.h>
+
+#include "utils/Profiler.h"
+
+using namespace std;
+
+// libzypp logger settings
+#undef  ZYPP_BASE_LOGGER_LOGGROUP
+#define ZYPP_BASE_LOGGER_LOGGROUP "zypper"
+
+// ---------------------------------------------------------------------------
+
+static double monotonic_us()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double origin_us = monotonic_us();
+
+Profiler::Sample Profiler::Sample::now()
+{
+  Sample sample;
+  sample.wall = monotonic_us() - origin_us;
+
+  struct timespec ts;
+  ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  sample.cpu = ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+
+  struct rusage usage;
+  ::getrusage(RUSAGE_SELF, &usage);
+  sample.maxrss = usage.ru_maxrss;
+
+  sample.heap = -1;
+  if (Profiler::instance().enabled())
+  {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = ::mallinfo2();
+#else
+    struct mallinfo info = ::mallinfo();
+#endif
+    // small chunks and mmap()ed big ones
+    sample.heap = (long long) info.uordblks + (long long) info.hblkhd;
+  }
+  return sample;
+}
+
+// ---------------------------------------------------------------------------
+
+Profiler::Profiler()
+  : _enabled(false)
+{}
+
+Profiler & Profiler::instance()
+{
+  static Profiler _instance;
+  return _instance;
+}
+
+void Profiler::enable(const string & file)
+{
+  _enabled = true;
+  _file = file;
+  MIL << "profiling into " << file << endl;
+}
+
+void Profiler::add(const string & name, const Sample & start, const Sample & end)
+{
+  if (!_enabled)
+    return;
+  Event event;
+  event.name = name;
+  event.start = start;
+  event.end = end;
+  _events.push_back(event);
+}
+
+void Profiler::write() const
+{
+  if (!_enabled)
+    return;
+
+  ofstream out(_file.c_str());
+  dumpOn(out);
+  if (!out)
+    cerr << zypp::str::form("Could not write the profile to %s.", _file.c_str()) << endl;
+}
+
+void Profiler::dumpOn(ostream & out) const
+{
+  pid_t pid = ::getpid();
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  for_(it, _events.begin(), _events.end())
+  {
+    out << (it == _events.begin() ? "" : ",") << endl
+        << "{\"name\": \"" << zypp::str::escape(it->name, '"') << "\""
+        << ", \"cat\": \"zypper\", \"ph\": \"X\""
+        << ", \"pid\": " << pid << ", \"tid\": " << pid
+        << zypp::str::form(", \"ts\": %.0f, \"dur\": %.0f",
+                           it->start.wall, it->end.wall - it->start.wall)
+        << ", \"args\": {"
+        << zypp::str::form("\"cpu_ms\": %.3f", (it->end.cpu - it->start.cpu) / 1e3)
+        << ", \"maxrss_kb\": " << it->end.maxrss;
+    if (it->start.heap >= 0 && it->end.heap >= 0)
+      out << zypp::str::form(", \"heap_delta_kb\": %lld", (it->end.heap - it->start.heap) / 1024);
+    out << "}}";
+  }
+  out << endl << "]}" << endl;
+}
+
+// ---------------------------------------------------------------------------
+
+ProfileScope::ProfileScope(const char * name, const string & detail)
+  : _name(name)
+  , _detail(detail)
+  , _start(Profiler::Sample::now())
+{}
+
+ProfileScope::~ProfileScope()
+{
+  Profiler & profiler(Profiler::instance());
+  if (!profiler.enabled())
+    return;
+  profiler.add(_detail.empty() ? string(_name) : string(_name) + " " + _detail,
+               _start, Profiler::Sample::now());
+}
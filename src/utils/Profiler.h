@@ -0,0 +1,94 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#ifndef ZYPPER_UTILS_PROFILER_H_
+#define ZYPPER_UTILS_PROFILER_H_
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+#include <zypp/base/NonCopyable.h>
+
+/**
+ * Records the phases of a zypper run (zypper --profile) and writes them
+ * in the Chrome trace event format, which can be loaded into
+ * chrome://tracing, Perfetto and similar trace viewers.
+ *
+ * Every phase becomes a complete ("X") event with the wall time, the CPU
+ * time, the peak RSS at its end and the change of the malloc heap in use
+ * (by zypper, libzypp and libsolv) during it. Nested phases show up nested.
+ */
+class Profiler : private zypp::base::NonCopyable
+{
+public:
+  /** Resource usage at a point in time. */
+  struct Sample
+  {
+    /** Wall time in microseconds since the profiler was created. */
+    double wall;
+    /** CPU time of the process in microseconds. */
+    double cpu;
+    /** Peak resident set size in KiB. */
+    long maxrss;
+    /** Bytes of the malloc heap in use, -1 if not known (the heap is
+     *  looked at only while profiling, it takes a while). */
+    long long heap;
+
+    static Sample now();
+  };
+
+  static Profiler & instance();
+
+  /** Start recording. The trace is written to \a file by \ref write(). */
+  void enable(const std::string & file);
+  bool enabled() const
+  { return _enabled; }
+
+  /** Record phase \a name which ran from \a start to \a end. */
+  void add(const std::string & name, const Sample & start, const Sample & end);
+
+  /** Write the recorded phases to the file given to \ref enable(), if enabled. */
+  void write() const;
+
+  /** Write the recorded phases as trace event JSON to \a out. */
+  void dumpOn(std::ostream & out) const;
+
+private:
+  Profiler();
+
+  struct Event
+  {
+    std::string name;
+    Sample start;
+    Sample end;
+  };
+
+  bool _enabled;
+  std::string _file;
+  std::vector<Event> _events;
+};
+
+/**
+ * Records the time from construction to destruction as a phase of the run,
+ * if the profiler is enabled by then (so that it works also for the phase
+ * in which --profile is parsed).
+ */
+class ProfileScope : private zypp::base::NonCopyable
+{
+public:
+  /** \a detail, if not empty, is appended to \a name, e.g. a repo alias. */
+  ProfileScope(const char * name, const std::string & detail = std::string());
+  ~ProfileScope();
+
+private:
+  const char * _name;
+  std::string _detail;
+  Profiler::Sample _start;
+};
+
+#endif /* ZYPPER_UTILS_PROFILER_H_ */
@@ -7,7 +7,9 @@
 
 #include <sstream>
 #include <iostream>
+#include <cstdlib>
 #include <unistd.h>          // for getcwd()
+#include <sys/stat.h>
 
 #include <zypp/base/Logger.h>
 #include <zypp/base/String.h>
@@ -527,6 +529,47 @@ DownloadMode get_download_option(Zypper & zypper, bool quiet)
 
 // ----------------------------------------------------------------------------
 
+std::string user_cache_dir()
+{
+  const char * env = ::getenv("XDG_CACHE_HOME");
+  if (env && *env)
+    return string(env) + "/zypper";
+  env = ::getenv("HOME");
+  if (env && *env)
+    return string(env) + "/.cache/zypper";
+  return string();
+}
+
+bool assert_own_dir(const Pathname & dir)
+{
+  Pathname existing(dir);
+  while (!PathInfo(existing).isExist() && existing != existing.dirname())
+    existing = existing.dirname();
+  if (PathInfo(existing).owner() != ::geteuid())
+    return false;
+  return filesystem::assert_dir(dir) == 0 && PathInfo(dir).owner() == ::geteuid();
+}
+
+std::string file_stamp(const Pathname & path)
+{
+  struct ::stat st;
+  if (::stat(path.c_str(), &st) != 0)
+    return "-";
+  return str::form("%llu %llu %lld.%09ld",
+                   (unsigned long long) st.st_size,
+                   (unsigned long long) st.st_ino,
+                   (long long) st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+}
+
+std::string rpmdb_stamp(const Pathname & root)
+{
+  Pathname rpmdb(root / "var/lib/rpm");
+  return file_stamp(rpmdb)
+      + " " + file_stamp(rpmdb / "Packages")
+      + " " + file_stamp(rpmdb / "Packages.db")
+      + " " + file_stamp(rpmdb / "rpmdb.sqlite");
+}
+
 bool packagekit_running()
 {
   bool result = false;
@@ -131,6 +131,32 @@ void list_processes_using_deleted_files(Zypper & zypper);
  */
 zypp::DownloadMode get_download_option(Zypper & zypper, bool quiet = false);
 
+/**
+ * The user's cache directory for zypper ($XDG_CACHE_HOME/zypper or
+ * ~/.cache/zypper), empty if we don't know where to put it.
+ */
+std::string user_cache_dir();
+
+/**
+ * Create \a dir (and its parents) unless it exists, but only in a tree we
+ * own: the nearest existing ancestor of \a dir must be owned by the
+ * effective user. So root under sudo, which keeps $HOME, doesn't leave
+ * directories of root in the home of the user.
+ *
+ * \return whether \a dir exists now and is owned by the effective user
+ */
+bool assert_own_dir(const zypp::Pathname & dir);
+
+/** Size, inode and mtime of \a path, "-" if it does not exist. */
+std::string file_stamp(const zypp::Pathname & path);
+
+/**
+ * Changes whenever the rpm database in \a root changes, whatever its
+ * backend: the \ref file_stamp() of var/lib/rpm and of the Packages
+ * (BerkeleyDB), Packages.db (ndb) and rpmdb.sqlite files in it.
+ */
+std::string rpmdb_stamp(const zypp::Pathname & root);
+
 /** Check whether packagekit is running using a DBus call */
 bool packagekit_running();
 
@@ -7,9 +7,11 @@
 
 #include <cwchar>
 #include <cstring>
+#include <cstdio>
 #include <ostream>
 
 #include "utils/text.h"
+#include "utils/width.h"
 
 using namespace std;
 
@@ -19,48 +21,9 @@ using namespace std;
 // - columns (Chinese characters are 2 columns wide)
 // In #328918 see how confusing these leads to misalignment.
 
-// return the number of columns in str, or -1 if there's an error
-static
-int mbs_width_e (const string & str)
-{
-  // from smpppd.src.rpm/format.cc, thanks arvin
-
-  const char* ptr = str.c_str ();
-  size_t s_bytes = str.length ();
-  int s_cols = 0;
-  bool in_ctrlseq = false;
-
-  mbstate_t shift_state;
-  memset (&shift_state, 0, sizeof (shift_state));
-
-  wchar_t wc;
-  size_t c_bytes;
-
-  // mbrtowc produces one wide character from a multibyte string
-  while ((c_bytes = mbrtowc (&wc, ptr, s_bytes, &shift_state)) > 0)
-  {
-    if (c_bytes >= (size_t) -2) // incomplete (-2) or invalid (-1) sequence
-      return -1;
-
-    // ignore the length of terminal control sequences in order
-    // to compute the length of colored text correctly
-    if (!in_ctrlseq && ::wcsncmp(&wc, L"\033", 1) == 0)
-      in_ctrlseq = true;
-    else if (in_ctrlseq && ::wcsncmp(&wc, L"m", 1) == 0)
-      in_ctrlseq = false;
-    else if (!in_ctrlseq)
-      s_cols += ::wcwidth(wc);
-
-    s_bytes -= c_bytes;
-    ptr += c_bytes;
-  }
-
-  return s_cols;
-}
-
 unsigned mbs_width (const string& str)
 {
-  int c = mbs_width_e(str);
+  int c = utf8_width(str);
   if (c < 0)
     return str.length();        // fallback if there was an error
   else
@@ -78,58 +41,42 @@ std::string mbs_substr_by_width(
     return string();
 
   const char * ptr = str.c_str();
+  const char * end = ptr + str.length();
   const char * sptr = NULL;
   const char * eptr = NULL;
-  size_t s_bytes = str.length();
   int s_cols = 0, s_cols_prev;
-  bool in_ctrlseq = false;
-
-  mbstate_t shift_state;
-  memset (&shift_state, 0, sizeof (shift_state));
 
-  wchar_t wc;
-  size_t c_bytes;
-
-  // mbrtowc produces one wide character from a multibyte string
-  while ((c_bytes = mbrtowc (&wc, ptr, s_bytes, &shift_state)) > 0)
+  while (ptr < end)
   {
-    if (c_bytes >= (size_t) -2) // incomplete (-2) or invalid (-1) sequence
+    const char * cptr = ptr;
+    int c_cols = utf8_char_width(ptr, end);
+    if (c_cols < 0) // invalid or incomplete sequence
       return str.substr(pos, n); // default to normal string substr
 
     s_cols_prev = s_cols;
-    // ignore the length of terminal control sequences in order
-    // to compute the length of the string correctly
-    if (!in_ctrlseq && ::wcsncmp(&wc, L"\033", 1) == 0)
-      in_ctrlseq = true;
-    else if (in_ctrlseq && ::wcsncmp(&wc, L"m", 1) == 0)
-      in_ctrlseq = false;
-    else if (!in_ctrlseq)
-      s_cols += ::wcwidth(wc);
+    s_cols += c_cols;
 
     // mark the beginning
     if (sptr == NULL && (unsigned) s_cols >= pos)
     {
       // cut at the right column, include also the current character
       if ((unsigned) s_cols_prev == pos)
-        sptr = ptr;
+        sptr = cptr;
       // current character cut into pieces, don't include it
       else
-        sptr = ptr + c_bytes;
+        sptr = ptr;
     }
     // mark the end
     if (n != string::npos && (unsigned) s_cols >= pos + n)
     {
       // cut at the right column, include also the current character
       if ((unsigned) s_cols == pos + n)
-        eptr = ptr + c_bytes;
+        eptr = ptr;
       // current character cut into pieces, don't include it
       else
-        eptr = ptr;
+        eptr = cptr;
       break;
     }
-
-    s_bytes -= c_bytes;
-    ptr += c_bytes;
   }
 
   if (eptr == NULL)
@@ -245,3 +192,28 @@ void mbs_write_wrapped(ostream & out, const string & text,
   }
   while(bytes_read > 0);
 }
+
+string json_string(const string & str)
+{
+  string ret("\"");
+  for (string::const_iterator it = str.begin(); it != str.end(); ++it)
+  {
+    switch (*it)
+    {
+    case '"':  ret += "\\\""; break;
+    case '\\': ret += "\\\\"; break;
+    case '\n': ret += "\\n"; break;
+    case '\t': ret += "\\t"; break;
+    default:
+      if ((unsigned char) *it < 0x20)
+      {
+        char buf[8];
+        ::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char) *it);
+        ret += buf;
+      }
+      else
+        ret += *it;
+    }
+  }
+  return ret + "\"";
+}
@@ -44,4 +44,10 @@ std::string mbs_substr_by_width(
     std::string::size_type pos,
     std::string::size_type n = std::string::npos);
 
+/**
+ * Returns \a str as a quoted JSON string literal, with the quotes,
+ * backslashes and control characters escaped.
+ */
+std::string json_string(const std::string & str);
+
 #endif /* ZYPPER_UTILS_TEXT_H_ */
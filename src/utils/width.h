@@ -0,0 +1,59 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+/**
+ * Display width of UTF-8 text, shared by mbs_width() and utf8::string.
+ *
+ * Runs of printable ASCII are counted 16 bytes at a time using SSE2 (8
+ * bytes at a time elsewhere), and so are runs of ASCII mixed with
+ * two-byte Latin letters (U+00C0 to U+02FF), which are all one column
+ * wide. Any other character is decoded and looked up in tables of
+ * zero-width and East Asian wide characters (see tools/gen-width-tables),
+ * so the result doesn't depend on the locale.
+ */
+#ifndef ZYPPER_UTILS_WIDTH_H_
+#define ZYPPER_UTILS_WIDTH_H_
+
+#include <string>
+#include <cstddef>
+
+#include <stdint.h>
+
+/**
+ * Columns taken by the code point \a cp: 0 for control characters,
+ * combining marks and format characters, 2 for East Asian wide and
+ * fullwidth characters, 1 for the rest.
+ */
+int ucs_width(uint32_t cp);
+
+/**
+ * Columns taken by the character at \a ptr, which is advanced past it.
+ *
+ * If \a skip_escapes is set, a terminal control sequence (from ESC up to
+ * the next 'm', as used for colors) is taken as one character with no
+ * width. Otherwise ESC counts as one column, like the printable characters
+ * of the sequence.
+ *
+ * \return the width, or -1 if the text at \a ptr is not valid UTF-8
+ *         (\a ptr is advanced by one byte then)
+ */
+int utf8_char_width(const char *& ptr, const char * end, bool skip_escapes = true);
+
+/**
+ * Columns taken by the UTF-8 text \a str of \a size bytes, see
+ * \ref utf8_char_width(). (Not an overload of \ref utf8_width(), so that
+ * e.g. utf8_width("x", false) can't end up here with a size of 0.)
+ *
+ * \return the width, or -1 if the text is not valid UTF-8
+ */
+int utf8_buf_width(const char * str, size_t size, bool skip_escapes);
+
+/** Columns taken by the UTF-8 text \a str, see \ref utf8_buf_width(). */
+inline int utf8_width(const std::string & str, bool skip_escapes = true)
+{ return utf8_buf_width(str.data(), str.size(), skip_escapes); }
+
+#endif /* ZYPPER_UTILS_WIDTH_H_ */
@@ -10,8 +10,20 @@
 /* (c) Novell Inc. */
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include <zypp/ZYppFactory.h>
+#include <zypp/ZConfig.h>
 #include <zypp/base/LogControl.h>
 #include <zypp/base/Logger.h>
 #include <zypp/base/String.h>
@@ -24,6 +36,8 @@
 #include <zypp/RepoManager.h>
 #include <zypp/PathInfo.h>
 
+#include "zypp-refresh.h"
+
 #undef  ZYPP_BASE_LOGGER_LOGGROUP
 #define ZYPP_BASE_LOGGER_LOGGROUP "zypp-refresh"
 
@@ -87,6 +101,334 @@ class DigestCallbacks
     ~DigestCallbacks() { _digestReport.disconnect(); }
 };
 
+/** Refresh metadata and cache of a repo, print a progress line.
+ * \return true on success */
+static bool refreshRepo(RepoManager & manager, const RepoInfo & repo,
+                        RepoManager::RawMetadataRefreshPolicy policy = RepoManager::RefreshIfNeeded)
+{
+  MIL << "Going to refresh repository: "
+    "alias:[" << repo.alias() << "] "
+    "url:[" << repo.url() << "] " << endl;
+
+  try
+  {
+    cout << "refreshing '" << repo.alias() << "' ." << flush;
+    manager.refreshMetadata(repo, policy);
+    cout << "." << flush;
+    manager.buildCache(repo);
+    cout << ". Done." << endl;
+  }
+  catch (const Exception &excpt_r )
+  {
+    cerr
+      << " Error:" << endl
+      << str::form(
+        "Could not refresh repository '%s':\n%s\n%s",
+        repo.name().c_str(), excpt_r.asUserString().c_str(), excpt_r.historyAsString().c_str())
+      << endl;
+    return false;
+  }
+  return true;
+}
+
+/** Whether to refresh the repo at all. Logs the reason if not. */
+static bool isAutorefreshRepo(const RepoInfo & repo)
+{
+  Url url = repo.url();
+  string scheme(url.getScheme());
+
+  if (scheme == "cd" || scheme == "dvd")
+  {
+    MIL << "Skipping CD/DVD repository: "
+      "alias:[" << repo.alias() << "] "
+      "url:[" << url << "] " << endl;
+    return false;
+  }
+
+  // refresh only enabled repos with enabled autorefresh (bnc #410791)
+  if (!(repo.enabled() && repo.autorefresh()))
+  {
+    MIL << "Skipping disabled/no-autorefresh repository: "
+      "alias:[" << repo.alias() << "] "
+      "url:[" << url << "] " << endl;
+    return false;
+  }
+
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////
+// daemon mode
+//
+// The daemon process itself never touches the ZYpp instance, so that it
+// does not hold the ZYpp lock between the refresh cycles. Each cycle runs
+// in a forked child which acquires the lock, refreshes the repos which are
+// due (each in a child of its own, at most 'jobs' at a time), writes the
+// status file and exits, releasing the lock.
+///////////////////////////////////////////////////////////////////
+
+/** Sleep at least this long between cycles (seconds). */
+#define ZYPP_REFRESH_MIN_SLEEP 60
+
+struct Schedule
+{
+  Schedule() : last_check(0), next_check(0), ok(true) {}
+  time_t last_check;
+  time_t next_check;
+  bool ok;
+};
+typedef map<string, Schedule> ScheduleMap;
+
+static volatile sig_atomic_t stop_daemon = 0;
+
+static void handleStopSignal(int)
+{ stop_daemon = 1; }
+
+/** Read the repo entries of the status file (if any) into \a schedule. */
+static void readStatus(ScheduleMap & schedule)
+{
+  ifstream in(ZYPP_REFRESH_STATUS_FILE);
+  string line;
+  while (getline(in, line))
+  {
+    istringstream str(line);
+    string key, result, alias;
+    Schedule entry;
+    str >> key;
+    if (key != "repo")
+      continue;
+    str >> entry.last_check >> entry.next_check >> result >> ws;
+    getline(str, alias);
+    if (alias.empty())
+    {
+      WAR << "Ignoring malformed status line: " << line << endl;
+      continue;
+    }
+    entry.ok = (result == "ok");
+    schedule[alias] = entry;
+  }
+}
+
+/** Atomically replace the status file. */
+static bool writeStatus(pid_t pid, const ScheduleMap & schedule)
+{
+  string tmpfile(string(ZYPP_REFRESH_STATUS_FILE) + ".new");
+  {
+    ofstream out(tmpfile.c_str());
+    out << "# zypp-refresh daemon status" << endl
+        << "pid " << pid << endl
+        << "updated " << ::time(NULL) << endl;
+    for (ScheduleMap::const_iterator it = schedule.begin(); it != schedule.end(); ++it)
+      out << "repo " << it->second.last_check << " " << it->second.next_check
+          << " " << (it->second.ok ? "ok" : "failed") << " " << it->first << endl;
+    if (!out)
+    {
+      ERR << "Could not write " << tmpfile << endl;
+      return false;
+    }
+  }
+  if (::rename(tmpfile.c_str(), ZYPP_REFRESH_STATUS_FILE) != 0)
+  {
+    ERR << "Could not rename " << tmpfile << ": " << ::strerror(errno) << endl;
+    return false;
+  }
+  return true;
+}
+
+/** Wait for one of the \a running repo refreshes and record its result. */
+static void reapRefresh(map<pid_t, string> & running, ScheduleMap & schedule, time_t interval)
+{
+  int status = 0;
+  pid_t pid = ::waitpid(-1, &status, 0);
+  if (pid < 0)
+  {
+    if (errno == ECHILD)
+      running.clear();
+    return;
+  }
+
+  map<pid_t, string>::iterator it = running.find(pid);
+  if (it == running.end())
+    return;
+
+  Schedule & entry(schedule[it->second]);
+  entry.last_check = ::time(NULL);
+  entry.next_check = entry.last_check + interval;
+  entry.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  MIL << "Refresh of '" << it->second << "' " << (entry.ok ? "succeeded" : "failed") << endl;
+  running.erase(it);
+}
+
+/**
+ * One refresh cycle, run in a child of the daemon.
+ * \return 0 on success, 1 if the ZYpp lock could not be acquired
+ */
+static int runCycle(pid_t daemon_pid, unsigned jobs, time_t interval)
+{
+  ZYpp::Ptr God;
+  try
+  {
+    God = zypp::getZYpp();
+    God->initializeTarget("/");
+  }
+  catch ( const Exception & excpt_r )
+  {
+    ZYPP_CAUGHT (excpt_r);
+    MIL << "Package manager not available, will try again later." << endl;
+    return 1;
+  }
+
+  RepoManager manager;
+
+  ScheduleMap old, schedule;
+  readStatus(old);
+
+  time_t now = ::time(NULL);
+  list<RepoInfo> due;
+  for (RepoManager::RepoConstIterator it = manager.repoBegin(); it != manager.repoEnd(); ++it)
+  {
+    if (!isAutorefreshRepo(*it))
+      continue;
+
+    Schedule entry;
+    ScheduleMap::const_iterator oldit = old.find(it->alias());
+    if (oldit != old.end())
+      entry = oldit->second;
+    else
+      // not checked by us yet, start with the time of the last refresh
+      entry.last_check = manager.metadataStatus(*it).timestamp();
+    entry.next_check = entry.last_check + interval;
+    schedule[it->alias()] = entry;
+
+    if (entry.next_check <= now)
+      due.push_back(*it);
+  }
+  MIL << due.size() << " of " << schedule.size() << " repos are due for refresh." << endl;
+
+  map<pid_t, string> running;
+  for (list<RepoInfo>::const_iterator it = due.begin(); it != due.end(); ++it)
+  {
+    while (running.size() >= jobs)
+      reapRefresh(running, schedule, interval);
+
+    cout << flush;
+    cerr << flush;
+    pid_t pid = ::fork();
+    if (pid == 0)
+    {
+      // the refresh schedule is ours, ignore the delay from zypp.conf
+      bool ok = refreshRepo(manager, *it, RepoManager::RefreshIfNeededIgnoreDelay);
+      cout << flush;
+      cerr << flush;
+      ::_exit(ok ? 0 : 1); // the lock belongs to the parent
+    }
+    if (pid < 0)
+    {
+      ERR << "fork() failed: " << ::strerror(errno) << endl;
+      schedule[it->alias()].ok = false;
+      continue;
+    }
+    running[pid] = it->alias();
+  }
+  while (!running.empty())
+    reapRefresh(running, schedule, interval);
+
+  writeStatus(daemon_pid, schedule);
+  return 0;
+}
+
+/** The daemon main loop. */
+static int runDaemon(unsigned jobs, time_t interval)
+{
+  if (::daemon(0, 0) != 0)
+  {
+    cerr << "Could not start the daemon: " << ::strerror(errno) << endl;
+    return 1;
+  }
+
+  struct sigaction sa;
+  ::memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = handleStopSignal;
+  ::sigaction(SIGTERM, &sa, NULL);
+  ::sigaction(SIGINT, &sa, NULL);
+  ::signal(SIGHUP, SIG_IGN);
+
+  pid_t self = ::getpid();
+  ScheduleMap schedule;
+  readStatus(schedule);
+  if (!writeStatus(self, schedule))
+    return 1;
+  MIL << "zypp-refresh daemon started, pid " << self << ", " << jobs
+      << " jobs, interval " << interval << "s" << endl;
+
+  while (!stop_daemon)
+  {
+    pid_t cycle = ::fork();
+    if (cycle == 0)
+    {
+      ::signal(SIGTERM, SIG_DFL);
+      ::signal(SIGINT, SIG_DFL);
+      // own process group, so that the daemon can stop the whole cycle
+      ::setpgid(0, 0);
+      // exit() runs the destructors releasing the ZYpp lock
+      ::exit(runCycle(self, jobs, interval));
+    }
+
+    int status = 0;
+    if (cycle < 0)
+      ERR << "fork() failed: " << ::strerror(errno) << endl;
+    else
+    {
+      while (::waitpid(cycle, &status, 0) < 0 && errno == EINTR)
+        if (stop_daemon)
+          ::kill(-cycle, SIGTERM);
+    }
+
+    // sleep until the next repo is due
+    time_t now = ::time(NULL);
+    time_t wakeup = now + interval;
+    schedule.clear();
+    readStatus(schedule);
+    for (ScheduleMap::const_iterator it = schedule.begin(); it != schedule.end(); ++it)
+      wakeup = min(wakeup, it->second.next_check);
+    wakeup = max(wakeup, now + (time_t) ZYPP_REFRESH_MIN_SLEEP);
+    DBG << "Next cycle in " << (wakeup - now) << "s" << endl;
+
+    while (!stop_daemon && (now = ::time(NULL)) < wakeup)
+      ::sleep(wakeup - now);
+  }
+
+  ::unlink(ZYPP_REFRESH_STATUS_FILE);
+  MIL << "zypp-refresh daemon stopped." << endl;
+  return 0;
+}
+
+/** Parse \a arg as a positive number into \a value. */
+static bool parsePositive(const char * arg, unsigned & value)
+{
+  if (!::isdigit((unsigned char) *arg))
+    return false;
+  char * end = NULL;
+  errno = 0;
+  unsigned long n = ::strtoul(arg, &end, 10);
+  if (errno || *end || n == 0 || n > 1000000)
+    return false;
+  value = n;
+  return true;
+}
+
+static void usage(ostream & out)
+{
+  out << "Usage: zypp-refresh [--daemon [--jobs <N>] [--interval <MINUTES>]]" << endl
+      << endl
+      << "Without options, refresh all enabled repositories with autorefresh turned" << endl
+      << "on once. With --daemon, keep running in the background and refresh each" << endl
+      << "of them when <MINUTES> (default: repo.refresh.delay of zypp.conf, or 10" << endl
+      << "if that is 0) have passed since it was last checked, using up to <N>" << endl
+      << "(default: 2) processes. Both must be positive numbers." << endl
+      << "The status of the daemon is written to " << ZYPP_REFRESH_STATUS_FILE << "." << endl;
+}
+
 int main(int argc, char **argv)
 {
   const char *logfile = getenv("ZYPP_LOGFILE");
@@ -95,6 +437,54 @@ int main(int argc, char **argv)
   else
     zypp::base::LogControl::instance().logfile( ZYPP_REFRESH_LOG );
 
+  bool daemon_mode = false;
+  unsigned jobs = 2;
+  // repo.refresh.delay of zypp.conf unless given, 10 minutes if that is 0
+  unsigned interval = ZConfig::instance().repo_refresh_delay();
+  if (!interval)
+    interval = 10;
+  for (int i = 1; i < argc; ++i)
+  {
+    string arg(argv[i]);
+    if (arg == "-d" || arg == "--daemon")
+      daemon_mode = true;
+    else if ((arg == "-j" || arg == "--jobs") && i + 1 < argc)
+    {
+      if (!parsePositive(argv[++i], jobs))
+      {
+        cerr << "Invalid number of jobs: '" << argv[i] << "'" << endl << endl;
+        usage(cerr);
+        return 1;
+      }
+    }
+    else if ((arg == "-i" || arg == "--interval") && i + 1 < argc)
+    {
+      if (!parsePositive(argv[++i], interval))
+      {
+        cerr << "Invalid interval: '" << argv[i] << "'" << endl << endl;
+        usage(cerr);
+        return 1;
+      }
+    }
+    else if (arg == "-h" || arg == "--help")
+    {
+      usage(cout);
+      return 0;
+    }
+    else
+    {
+      usage(cerr);
+      return 1;
+    }
+  }
+
+  if (daemon_mode)
+  {
+    KeyRingCallbacks keyring_callbacks;
+    DigestCallbacks digest_callbacks;
+    return runDaemon(jobs, 60 * interval);
+  }
+
   ZYpp::Ptr God;
   try
   {
@@ -129,48 +519,11 @@ int main(int argc, char **argv)
   unsigned repocount = 0, errcount = 0;
   for(list<RepoInfo>::iterator it = repos.begin(); it != repos.end(); ++it, ++repocount)
   {
-    Url url = it->url();
-    string scheme(url.getScheme());
-
-    if (scheme == "cd" || scheme == "dvd")
-    {
-      MIL << "Skipping CD/DVD repository: "
-        "alias:[" << it->alias() << "] "
-        "url:[" << url << "] " << endl;
+    if (!isAutorefreshRepo(*it))
       continue;
-    }
 
-    // refresh only enabled repos with enabled autorefresh (bnc #410791)
-    if (!(it->enabled() && it->autorefresh()))
-    {
-      MIL << "Skipping disabled/no-autorefresh repository: "
-        "alias:[" << it->alias() << "] "
-        "url:[" << url << "] " << endl;
-      continue;
-    }
-
-    MIL << "Going to refresh repository: "
-      "alias:[" << it->alias() << "] "
-      "url:[" << url << "] " << endl;
-
-    try
-    {
-      cout << "refreshing '" << it->alias() << "' ." << flush;
-      manager.refreshMetadata(*it);
-      cout << "." << flush;
-      manager.buildCache(*it);
-      cout << ". Done." << endl;
-    }
-    catch (const Exception &excpt_r )
-    {
-      cerr
-        << " Error:" << endl
-        << str::form(
-          "Could not refresh repository '%s':\n%s\n%s",
-          it->name().c_str(), excpt_r.asUserString().c_str(), excpt_r.historyAsString().c_str())
-        << endl;
+    if (!refreshRepo(manager, *it))
       ++errcount;
-    }
   }
 
   if (errcount)
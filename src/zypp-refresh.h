@@ -0,0 +1,30 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#ifndef ZYPP_REFRESH_H_
+#define ZYPP_REFRESH_H_
+
+/**
+ * Status file of the 'zypp-refresh --daemon' background refresher.
+ *
+ * The file exists as long as the daemon runs and is replaced atomically
+ * after each refresh cycle. It consists of lines of the form
+ *
+ * \code
+ * # comment
+ * pid <daemon's pid>
+ * updated <time of the last update>
+ * repo <last check> <next check> <ok|failed> <alias>
+ * \endcode
+ *
+ * with times in seconds since the epoch. While the process with the pid is
+ * alive, zypper skips the autorefresh of the repositories refreshed 'ok'
+ * whose next check is still ahead.
+ */
+#define ZYPP_REFRESH_STATUS_FILE "/var/run/zypp-refresh.status"
+
+#endif /* ZYPP_REFRESH_H_ */
@@ -0,0 +1,93 @@
+/*---------------------------------------------------------------------------*\
+                          ____  _ _ __ _ __  ___ _ _
+                         |_ / || | '_ \ '_ \/ -_) '_|
+                         /__|\_, | .__/ .__/\___|_|
+                             |__/|_|  |_|
+\*---------------------------------------------------------------------------*/
+
+#include <iostream>
+#include <clocale>
+
+#include <zypp/base/LogTools.h>
+#include <zypp/base/LogControl.h>
+
+#include "main.h"
+#include "Zypper.h"
+#include "Daemon.h"
+
+#include "callbacks/rpm.h"
+#include "callbacks/keyring.h"
+#include "callbacks/repo.h"
+#include "callbacks/media.h"
+#include "callbacks/locks.h"
+#include "output/OutNormal.h"
+
+#define ZYPPERD_LOG "/var/log/zypperd.log"
+
+using namespace std;
+
+static void usage(ostream & out)
+{
+  out << "Usage: zypperd [--foreground]" << endl
+      << endl
+      << "Keep the installed and available packages loaded and answer the" << endl
+      << "query commands of zypper (search, info, packages, list-updates, ...)" << endl
+      << "on " << ZYPPERD_SOCKET << ". The packages are reloaded whenever the" << endl
+      << "rpm database or the repositories change. With --foreground, don't" << endl
+      << "detach from the terminal." << endl;
+}
+
+int main(int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+  bindtextdomain (PACKAGE, LOCALEDIR);
+  textdomain (PACKAGE);
+
+  const char *logfile = getenv("ZYPP_LOGFILE");
+  if (logfile == NULL)
+    logfile = ZYPPERD_LOG;
+  zypp::base::LogControl::instance().logfile( logfile );
+
+  MIL << "===== Hi, me zypperd " VERSION << endl;
+
+  bool foreground = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    string arg(argv[i]);
+    if (arg == "-f" || arg == "--foreground")
+      foreground = true;
+    else if (arg == "-h" || arg == "--help")
+    {
+      usage(cout);
+      return ZYPPER_EXIT_OK;
+    }
+    else
+    {
+      usage(cerr);
+      return ZYPPER_EXIT_ERR_SYNTAX;
+    }
+  }
+
+  Zypper & zypper = *Zypper::instance();
+  zypper.setOutputWriter(new OutNormal(Out::QUIET));
+
+  try
+  {
+    static RpmCallbacks rpm_callbacks;
+    static SourceCallbacks source_callbacks;
+    static MediaCallbacks media_callbacks;
+    static KeyRingCallbacks keyring_callbacks;
+    static DigestCallbacks digest_callbacks;
+    static LocksCallbacks locks_callbacks;
+  }
+  catch (const zypp::Exception & e)
+  {
+    ZYPP_CAUGHT(e);
+    zypper.out().error(e, "Failed to initialize zypper callbacks.");
+    return ZYPPER_EXIT_ERR_BUG;
+  }
+
+  zypper.config().read();
+
+  return daemon_run(zypper, foreground);
+}
@@ -0,0 +1,84 @@
+#include "TestSetup.h"
+#include "SearchIndex.h"
+
+using namespace std;
+using namespace zypp;
+
+namespace
+{
+  set<string> trigrams(const string & term, const PoolQuery & query)
+  {
+    set<string> result;
+    BOOST_CHECK(required_trigrams(term, query, result));
+    return result;
+  }
+
+  string components(const string & term, const PoolQuery & query)
+  {
+    vector<ComponentLookup> lookups;
+    BOOST_CHECK(required_components(term, query, lookups));
+    string result;
+    for (unsigned i = 0; i < lookups.size(); ++i)
+      result += "/" + lookups[i].key + (lookups[i].prefix ? "*" : "");
+    return result;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(required_trigrams_test)
+{
+  set<string> result;
+  PoolQuery substring;
+  BOOST_CHECK_EQUAL(trigrams("ZYpper", substring).size(), 4);
+  BOOST_CHECK(trigrams("ZYpper", substring).count("zyp"));
+  BOOST_CHECK(trigrams("ZYpper", substring).count("per"));
+  BOOST_CHECK(!required_trigrams("zy", substring, result));
+
+  PoolQuery glob;
+  glob.setMatchGlob();
+  set<string> g(trigrams("lib*zypp?", glob));
+  BOOST_CHECK_EQUAL(g.size(), 3);
+  BOOST_CHECK(g.count("lib") && g.count("zyp") && g.count("ypp"));
+  // nothing of three characters outside the brackets
+  BOOST_CHECK(!required_trigrams("a[bcd]e*", glob, result));
+
+  PoolQuery regex;
+  regex.setMatchRegex();
+  set<string> r(trigrams("^libzypp[0-9]+$", regex));
+  BOOST_CHECK_EQUAL(r.size(), 5);
+  BOOST_CHECK(!r.count("p[0"));
+  // an optional character isn't required
+  r = trigrams("zyppe?r", regex);
+  BOOST_CHECK_EQUAL(r.size(), 2);
+  BOOST_CHECK(!r.count("ppe"));
+  // neither are groups
+  r = trigrams("(foo)?bar", regex);
+  BOOST_CHECK_EQUAL(r.size(), 1);
+  BOOST_CHECK(r.count("bar"));
+  BOOST_CHECK(!required_trigrams("zypper|yast2", regex, result));
+}
+
+BOOST_AUTO_TEST_CASE(required_components_test)
+{
+  vector<ComponentLookup> result;
+  PoolQuery substring;
+  BOOST_CHECK_EQUAL(components("/usr/lib64/libFoo", substring), "/usr/lib64/libfoo*");
+  // the first part may be the end of a component
+  BOOST_CHECK_EQUAL(components("lib64/libfoo", substring), "/libfoo*");
+  BOOST_CHECK_EQUAL(components("/usr/bin/", substring), "/usr/bin");
+  BOOST_CHECK(!required_components("zypper", substring, result));
+
+  PoolQuery exact;
+  exact.setMatchExact();
+  BOOST_CHECK_EQUAL(components("/usr/bin/zypper", exact), "/usr/bin/zypper");
+
+  PoolQuery glob;
+  glob.setMatchGlob();
+  BOOST_CHECK_EQUAL(components("/usr/lib64/libfoo*", glob), "/usr/lib64/libfoo*");
+  BOOST_CHECK_EQUAL(components("/usr/*/zypper", glob), "/usr");
+  BOOST_CHECK_EQUAL(components("/usr/bin/zypper", glob), "/usr/bin/zypper");
+  BOOST_CHECK(!required_components("*/zypper", glob, result));
+
+  PoolQuery regex;
+  regex.setMatchRegex();
+  BOOST_CHECK(!required_components("/usr/bin/zypper", regex, result));
+}
@@ -0,0 +1,107 @@
+#include "TestSetup.h"
+#include "Table.h"
+
+using namespace std;
+
+namespace
+{
+  TableRow row(const string & a, const string & b)
+  {
+    TableRow tr;
+    tr << a << b;
+    return tr;
+  }
+
+  /** Column \a c of the rows of \a table, in their order. */
+  vector<string> column(const Table & table, unsigned c)
+  {
+    vector<string> result;
+    for (unsigned i = 0; i < table.size(); ++i)
+      result.push_back(table.row(i).columns()[c]);
+    return result;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(table_cell_pool_test)
+{
+  setlocale(LC_CTYPE, "en_US.UTF-8");
+  TableCellPool pool;
+  BOOST_CHECK_EQUAL(pool.intern(""), 0);
+
+  TableCellPool::Id id = pool.intern("zypper");
+  BOOST_CHECK(id != 0);
+  BOOST_CHECK_EQUAL(pool.intern("zypper"), id);
+  BOOST_CHECK_EQUAL(pool.str(id), "zypper");
+  BOOST_CHECK_EQUAL(pool.size(id), 6);
+  BOOST_CHECK_EQUAL(pool.width(id), 6);
+
+  TableCellPool::Id wide = pool.intern("和平");
+  BOOST_CHECK_EQUAL(pool.size(wide), 6);
+  BOOST_CHECK_EQUAL(pool.width(wide), 4);
+
+  BOOST_CHECK(pool.less(pool.intern("libzypp"), id));
+  BOOST_CHECK(!pool.less(id, pool.intern("libzypp")));
+  BOOST_CHECK(!pool.less(id, id));
+  // a prefix is less
+  BOOST_CHECK(pool.less(pool.intern("zypp"), id));
+
+  // the ids and strings survive growing the hash table
+  vector<TableCellPool::Id> ids;
+  for (unsigned i = 0; i < 5000; ++i)
+    ids.push_back(pool.intern(zypp::str::numstring(i)));
+  for (unsigned i = 0; i < 5000; ++i)
+  {
+    BOOST_CHECK_EQUAL(pool.intern(zypp::str::numstring(i)), ids[i]);
+    BOOST_CHECK_EQUAL(pool.str(ids[i]), zypp::str::numstring(i));
+  }
+  BOOST_CHECK_EQUAL(pool.intern("zypper"), id);
+}
+
+BOOST_AUTO_TEST_CASE(table_sort_test)
+{
+  Table table;
+  table << row("3", "zypper") << row("1", "libzypp") << row("2", "yast2")
+        << row("4", "libzypp");
+
+  table.sort(1);
+  vector<string> names(column(table, 1));
+  BOOST_CHECK_EQUAL(names.size(), 4);
+  BOOST_CHECK_EQUAL(names[0], "libzypp");
+  BOOST_CHECK_EQUAL(names[1], "libzypp");
+  BOOST_CHECK_EQUAL(names[2], "yast2");
+  BOOST_CHECK_EQUAL(names[3], "zypper");
+  // the sort is stable
+  BOOST_CHECK_EQUAL(table.row(0).columns()[0], "1");
+  BOOST_CHECK_EQUAL(table.row(1).columns()[0], "4");
+
+  table.sort(0);
+  vector<string> numbers(column(table, 0));
+  BOOST_CHECK_EQUAL(numbers[0], "1");
+  BOOST_CHECK_EQUAL(numbers[3], "4");
+  BOOST_CHECK_EQUAL(table.row(3).columns()[1], "libzypp");
+}
+
+BOOST_AUTO_TEST_CASE(table_row_heap_test)
+{
+  TableRowHeap heap(3, 1);
+  const char * names[] = { "m", "c", "x", "a", "k", "b", "z", "d" };
+  for (unsigned i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+    heap.add(row(zypp::str::numstring(i), names[i]));
+
+  Table table;
+  heap.addTo(table);
+  table.sort(1);
+  vector<string> kept(column(table, 1));
+  BOOST_CHECK_EQUAL(kept.size(), 3);
+  BOOST_CHECK_EQUAL(kept[0], "a");
+  BOOST_CHECK_EQUAL(kept[1], "b");
+  BOOST_CHECK_EQUAL(kept[2], "c");
+
+  // fewer rows than the limit are all kept
+  TableRowHeap small(10, 0);
+  small.add(row("b", ""));
+  small.add(row("a", ""));
+  Table table2;
+  small.addTo(table2);
+  BOOST_CHECK_EQUAL(table2.size(), 2);
+}
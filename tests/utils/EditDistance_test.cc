@@ -0,0 +1,37 @@
+#include "TestSetup.h"
+#include "utils/EditDistance.h"
+
+using namespace std;
+
+BOOST_AUTO_TEST_CASE(edit_distance_test)
+{
+  EditDistance distance("zypper");
+  BOOST_CHECK_EQUAL(distance("zypper"), 0);
+  BOOST_CHECK_EQUAL(distance("zyper"), 1);
+  BOOST_CHECK_EQUAL(distance("zyppper"), 1);
+  BOOST_CHECK_EQUAL(distance("zipper"), 1);
+  BOOST_CHECK_EQUAL(distance("yzpper"), 2);
+  BOOST_CHECK_EQUAL(distance(""), 6);
+  BOOST_CHECK_EQUAL(EditDistance("")("abc"), 3);
+  BOOST_CHECK_EQUAL(EditDistance("kitten")("sitting"), 3);
+  // bytes, not characters
+  BOOST_CHECK_EQUAL(EditDistance("\xc3\xa4")("a"), 2);
+}
+
+BOOST_AUTO_TEST_CASE(edit_distance_long_test)
+{
+  // 64 bytes is the longest pattern for the bit-vector algorithm, longer
+  // ones use the matrix; both must agree
+  string p64(64, 'a');
+  string p65(65, 'a');
+  BOOST_CHECK_EQUAL(EditDistance(p64)(p64), 0);
+  BOOST_CHECK_EQUAL(EditDistance(p64)(p65), 1);
+  BOOST_CHECK_EQUAL(EditDistance(p65)(p64), 1);
+  BOOST_CHECK_EQUAL(EditDistance(p65)(string(65, 'b')), 65);
+
+  string text(p64);
+  text[10] = 'b';
+  text.erase(40, 1);
+  BOOST_CHECK_EQUAL(EditDistance(p64)(text), 2);
+  BOOST_CHECK_EQUAL(EditDistance(p65)(text + "a"), 2);
+}
@@ -1,5 +1,6 @@
 #include "TestSetup.h"
 #include "utils/text.h"
+#include "utils/width.h"
 
 using namespace std;
 
@@ -10,6 +11,35 @@ BOOST_AUTO_TEST_CASE(mbs_width_test)
 
   width = mbs_width("Koľko stĺpcov zaberajú znaky '和平'?");
   BOOST_CHECK_EQUAL(width, 36);
+
+  // long enough for the vectorized runs
+  BOOST_CHECK_EQUAL(mbs_width("libzypp-devel-14.10.0-1.1.x86_64"), 32);
+  BOOST_CHECK_EQUAL(mbs_width("Knižnica na správu balíčkov a úložísk"), 37);
+  BOOST_CHECK_EQUAL(mbs_width("软件包管理库 (libzypp) 的命令行界面"), 35);
+  // combining acute accent
+  BOOST_CHECK_EQUAL(mbs_width("e\xcc\x81"), 1);
+  // colors don't take any space
+  BOOST_CHECK_EQUAL(mbs_width("\033[1;31mError:\033[0m package not found"), 24);
+  // invalid UTF-8 falls back to the number of bytes
+  BOOST_CHECK_EQUAL(mbs_width("ab\xc3(cdefghijklmnopqrstuvwxyz"), 28);
+}
+
+BOOST_AUTO_TEST_CASE(utf8_width_test)
+{
+  BOOST_CHECK_EQUAL(utf8_width(""), 0);
+  BOOST_CHECK_EQUAL(utf8_width("\xe2\x82"), -1);
+  // overlong form of '/'
+  BOOST_CHECK_EQUAL(utf8_width("\xc0\xaf"), -1);
+  // escape sequences counted if asked to (see TermLine::lhidden)
+  BOOST_CHECK_EQUAL(utf8_width("\033[0mx", false), 5);
+  BOOST_CHECK_EQUAL(utf8_width("\033[0mx"), 1);
+  BOOST_CHECK_EQUAL(utf8_buf_width("ab\xe4", 2, true), 2);
+
+  BOOST_CHECK_EQUAL(ucs_width(0x0301), 0);
+  BOOST_CHECK_EQUAL(ucs_width(0x00E4), 1);
+  BOOST_CHECK_EQUAL(ucs_width(0x3042), 2);
+  BOOST_CHECK_EQUAL(ucs_width(0xFF21), 2);
+  BOOST_CHECK_EQUAL(ucs_width(0x1F600), 2);
 }
 
 BOOST_AUTO_TEST_CASE(mbs_substr_by_width_test)
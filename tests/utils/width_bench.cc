@@ -0,0 +1,167 @@
+/*
+ * Microbenchmark of the display width functions (utils/width.h) used by
+ * mbs_width() and utf8::string::size(), compared to the mbrtowc/wcwidth
+ * loops they replaced.
+ *
+ * Usage: width_bench [iterations]
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <clocale>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "utils/text.h"
+#include "utils/width.h"
+
+using namespace std;
+
+// the former mbs_width_e(); it passed str.length() as the size, making
+// mbrtowc() report an incomplete character at the end, so mbs_width() fell
+// back to the length in bytes; here the terminating NUL is included
+static int old_mbs_width(const string & str)
+{
+  const char* ptr = str.c_str ();
+  size_t s_bytes = str.length () + 1;
+  int s_cols = 0;
+  bool in_ctrlseq = false;
+
+  mbstate_t shift_state;
+  memset (&shift_state, 0, sizeof (shift_state));
+
+  wchar_t wc;
+  size_t c_bytes;
+
+  while ((c_bytes = mbrtowc (&wc, ptr, s_bytes, &shift_state)) > 0)
+  {
+    if (c_bytes >= (size_t) -2)
+      return -1;
+
+    if (!in_ctrlseq && ::wcsncmp(&wc, L"\033", 1) == 0)
+      in_ctrlseq = true;
+    else if (in_ctrlseq && ::wcsncmp(&wc, L"m", 1) == 0)
+      in_ctrlseq = false;
+    else if (!in_ctrlseq)
+      s_cols += ::wcwidth(wc);
+
+    s_bytes -= c_bytes;
+    ptr += c_bytes;
+  }
+
+  return s_cols;
+}
+
+// the former utf8::string::size() in CJK locales
+static int old_utf8_size(const string & str)
+{
+  int len = 0;
+  const char *s = str.c_str();
+  for (size_t slen = str.size(); slen > 0; )
+  {
+    wchar_t wc;
+    size_t bytes = mbrtowc(&wc, s, slen, NULL);
+    if (bytes <= 0)
+      break;
+    len += wcwidth(wc);
+    slen -= bytes;
+    s += bytes;
+  }
+  return len;
+}
+
+typedef int (*WidthFunc)(const string &);
+
+static int new_mbs_width(const string & str)
+{ return mbs_width(str); }
+
+static int new_utf8_size(const string & str)
+{ return utf8_width(str, false); }
+
+static double bench(WidthFunc func, const vector<string> & cells, unsigned iterations, long & sum)
+{
+  struct timespec start, stop;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (unsigned i = 0; i < iterations; ++i)
+    for (vector<string>::const_iterator it = cells.begin(); it != cells.end(); ++it)
+      sum += func(*it);
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  double ns = (stop.tv_sec - start.tv_sec) * 1e9 + (stop.tv_nsec - start.tv_nsec);
+  return ns / iterations / cells.size();
+}
+
+int main(int argc, char * argv[])
+{
+  if (!setlocale(LC_CTYPE, "C.UTF-8") && !setlocale(LC_CTYPE, "en_US.UTF-8"))
+  {
+    fprintf(stderr, "no UTF-8 locale\n");
+    return 1;
+  }
+  unsigned iterations = argc > 1 ? atoi(argv[1]) : 200;
+
+  struct Set
+  {
+    const char * name;
+    vector<string> cells;
+  };
+  Set sets[4];
+
+  // typical 'zypper packages' cells
+  sets[0].name = "ascii";
+  for (unsigned i = 0; i < 1000; ++i)
+  {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "libpackage-name%u-devel", i);
+    sets[0].cells.push_back(buf);
+    snprintf(buf, sizeof(buf), "1.%u.%u-lp152.%u.1", i % 13, i % 7, i % 5);
+    sets[0].cells.push_back(buf);
+    sets[0].cells.push_back("openSUSE-Leap-15.2-Oss");
+    sets[0].cells.push_back("x86_64");
+    sets[0].cells.push_back("i");
+  }
+
+  // translated summaries
+  sets[1].name = "latin";
+  for (unsigned i = 0; i < 1000; ++i)
+  {
+    sets[1].cells.push_back("Knižnica na správu balíčkov a úložísk so závislosťami");
+    sets[1].cells.push_back("Bibliothèque de gestion des paquets équipée d'un résolveur");
+  }
+
+  sets[2].name = "cjk";
+  for (unsigned i = 0; i < 1000; ++i)
+  {
+    sets[2].cells.push_back("软件包管理库 (libzypp) 的命令行界面");
+    sets[2].cells.push_back("パッケージ管理のためのコマンドライン");
+  }
+
+  sets[3].name = "colored";
+  for (unsigned i = 0; i < 1000; ++i)
+  {
+    sets[3].cells.push_back("\033[1;31mError:\033[0m package \033[1mlibzypp\033[0m not found");
+    sets[3].cells.push_back("1.2.3-\033[1;33m4.5\033[0m");
+  }
+
+  printf("%-8s %12s %12s %8s   %12s %12s %8s\n", "cells",
+         "mbs_width", "old", "speedup", "utf8 size", "old", "speedup");
+  long sum = 0;
+  for (unsigned s = 0; s < sizeof(sets) / sizeof(sets[0]); ++s)
+  {
+    const vector<string> & cells(sets[s].cells);
+    for (vector<string>::const_iterator it = cells.begin(); it != cells.end(); ++it)
+      if (new_mbs_width(*it) != old_mbs_width(*it))
+        fprintf(stderr, "width of '%s' differs: %d, was %d\n",
+                it->c_str(), new_mbs_width(*it), old_mbs_width(*it));
+
+    double n1 = bench(new_mbs_width, cells, iterations, sum);
+    double o1 = bench(old_mbs_width, cells, iterations, sum);
+    double n2 = bench(new_utf8_size, cells, iterations, sum);
+    double o2 = bench(old_utf8_size, cells, iterations, sum);
+    printf("%-8s %9.1f ns %9.1f ns %7.1fx   %9.1f ns %9.1f ns %7.1fx\n", sets[s].name,
+           n1, o1, o1 / n1, n2, o2, o2 / n2);
+  }
+  // keep the calls from being optimized away
+  return sum == 42 ? 1 : 0;
+}